@@ -0,0 +1 @@
+#include "scope/scope.hpp"
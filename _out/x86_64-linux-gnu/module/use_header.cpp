@@ -0,0 +1,2 @@
+#include "scope/scope.hpp"
+int main() { int x = 0; { auto g = scope::make_scope_exit([&x]{ ++x; }); } return x - 1; }
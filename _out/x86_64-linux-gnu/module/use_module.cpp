@@ -0,0 +1,2 @@
+import scope;
+int main() { int x = 0; { auto g = scope::make_scope_exit([&x]{ ++x; }); } return x - 1; }
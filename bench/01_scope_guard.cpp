@@ -0,0 +1,167 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <functional>
+#include <utility>
+
+#include "bench.hpp"
+
+namespace {
+
+int counter = 0;
+
+void cleanup() noexcept { ++counter; }
+
+// Exit function factories. Each one produces the exit function that is handed
+// to the guard in the measured loop.
+//
+// C++11 deduces the return type of a lambda but not of a function, so the
+// lambdas are made by lambdas at namespace scope.
+const auto make_stateless_lambda = [](int&) { return []() noexcept { ++counter; }; };
+const auto make_capturing_lambda = [](int& x) { return [&x]() noexcept { ++x; }; };
+
+struct stateless_lambda
+{
+    static decltype(make_stateless_lambda(std::declval<int&>())) make(int& x) { return make_stateless_lambda(x); }
+};
+
+struct capturing_lambda
+{
+    static decltype(make_capturing_lambda(std::declval<int&>())) make(int& x) { return make_capturing_lambda(x); }
+};
+
+struct function_pointer
+{
+    static decltype(bench::opaque(&cleanup)) make(int&) { return bench::opaque(&cleanup); }
+};
+
+struct std_function
+{
+    static std::function<void()> make(int&) { return std::function<void()>{[]{ ++counter; }}; }
+};
+
+// Hand-written cleanup: call the exit function directly, or skip it by hand.
+template <typename Maker>
+void manual_fire(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto f = Maker::make(x);
+        f();
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <typename Maker>
+void manual_release(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto f = Maker::make(x);
+        bool armed = true;
+        bench::do_not_optimize(armed);
+        armed = false;
+        if(armed) {
+            f();
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <template <typename> class Guard, typename Maker>
+void guard_destroy(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto f = Maker::make(x);
+        {
+            Guard<decltype(f)> g{std::move(f)};
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <template <typename> class Guard, typename Maker>
+void guard_release(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto f = Maker::make(x);
+        {
+            Guard<decltype(f)> g{std::move(f)};
+            g.release();
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <template <typename> class Guard, typename Maker>
+void guard_move(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto f = Maker::make(x);
+        {
+            Guard<decltype(f)> g{std::move(f)};
+            Guard<decltype(f)> g2{std::move(g)};
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+#define BENCH_EXIT_FUNCTIONS(prefix, op, fn) \
+    bench::registrar{prefix "/" op "/stateless_lambda", &fn<stateless_lambda>}, \
+    bench::registrar{prefix "/" op "/capturing_lambda", &fn<capturing_lambda>}, \
+    bench::registrar{prefix "/" op "/function_pointer", &fn<function_pointer>}, \
+    bench::registrar{prefix "/" op "/std_function", &fn<std_function>}
+
+#define BENCH_GUARD(guard) \
+    bench::registrar{#guard "/destroy/stateless_lambda", &guard_destroy<scope::guard, stateless_lambda>}, \
+    bench::registrar{#guard "/destroy/capturing_lambda", &guard_destroy<scope::guard, capturing_lambda>}, \
+    bench::registrar{#guard "/destroy/function_pointer", &guard_destroy<scope::guard, function_pointer>}, \
+    bench::registrar{#guard "/destroy/std_function", &guard_destroy<scope::guard, std_function>}, \
+    bench::registrar{#guard "/release/stateless_lambda", &guard_release<scope::guard, stateless_lambda>}, \
+    bench::registrar{#guard "/release/capturing_lambda", &guard_release<scope::guard, capturing_lambda>}, \
+    bench::registrar{#guard "/release/function_pointer", &guard_release<scope::guard, function_pointer>}, \
+    bench::registrar{#guard "/release/std_function", &guard_release<scope::guard, std_function>}, \
+    bench::registrar{#guard "/move/stateless_lambda", &guard_move<scope::guard, stateless_lambda>}, \
+    bench::registrar{#guard "/move/capturing_lambda", &guard_move<scope::guard, capturing_lambda>}, \
+    bench::registrar{#guard "/move/function_pointer", &guard_move<scope::guard, function_pointer>}, \
+    bench::registrar{#guard "/move/std_function", &guard_move<scope::guard, std_function>}
+
+bench::registrar registrars[] = {
+    BENCH_EXIT_FUNCTIONS("manual", "fire", manual_fire),
+    BENCH_EXIT_FUNCTIONS("manual", "release", manual_release),
+    BENCH_GUARD(scope_exit),
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+    BENCH_GUARD(scope_success),
+    BENCH_GUARD(scope_fail),
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+};
+
+} // namespace
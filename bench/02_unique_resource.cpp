@@ -0,0 +1,184 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <functional>
+#include <utility>
+
+#include "bench.hpp"
+
+namespace {
+
+int closed = 0;
+
+void close_handle(int h) noexcept { closed += h; }
+
+// Deleter factories. Each one produces the deleter that is handed to
+// unique_resource in the measured loop.
+//
+// C++11 deduces the return type of a lambda but not of a function, so the
+// lambdas are made by lambdas at namespace scope.
+const auto make_stateless_lambda = [](int&) { return [](int h) noexcept { closed += h; }; };
+const auto make_capturing_lambda = [](int& x) { return [&x](int h) noexcept { x += h; }; };
+
+struct stateless_lambda
+{
+    static decltype(make_stateless_lambda(std::declval<int&>())) make(int& x) { return make_stateless_lambda(x); }
+};
+
+struct capturing_lambda
+{
+    static decltype(make_capturing_lambda(std::declval<int&>())) make(int& x) { return make_capturing_lambda(x); }
+};
+
+struct function_pointer
+{
+    static decltype(bench::opaque(&close_handle)) make(int&) { return bench::opaque(&close_handle); }
+};
+
+struct std_function
+{
+    static std::function<void(int)> make(int&) { return std::function<void(int)>{[](int h){ closed += h; }}; }
+};
+
+template <typename Maker>
+void manual_destroy(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto d = Maker::make(x);
+        int h = static_cast<int>(i);
+        d(h);
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <typename Maker>
+void manual_release(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto d = Maker::make(x);
+        int h = static_cast<int>(i);
+        bool owned = true;
+        bench::do_not_optimize(owned);
+        owned = false;
+        if(owned) {
+            d(h);
+        }
+        bench::do_not_optimize(h);
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <typename Maker>
+void unique_resource_destroy(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto d = Maker::make(x);
+        {
+            scope::unique_resource<int, decltype(d)> r{static_cast<int>(i), std::move(d)};
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <typename Maker>
+void unique_resource_reset(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto d = Maker::make(x);
+        {
+            scope::unique_resource<int, decltype(d)> r{static_cast<int>(i), std::move(d)};
+            r.reset();
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <typename Maker>
+void unique_resource_release(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto d = Maker::make(x);
+        {
+            scope::unique_resource<int, decltype(d)> r{static_cast<int>(i), std::move(d)};
+            r.release();
+            bench::do_not_optimize(r.get());
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <typename Maker>
+void unique_resource_move(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto d = Maker::make(x);
+        {
+            scope::unique_resource<int, decltype(d)> r{static_cast<int>(i), std::move(d)};
+            scope::unique_resource<int, decltype(d)> r2{std::move(r)};
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+template <typename Maker>
+void unique_resource_checked(bench::state& state)
+{
+    int x = 0;
+    for(auto i = state.iterations(); i; --i) {
+        {
+            auto r = scope::make_unique_resource_checked(static_cast<int>(i & 1) - 1, -1, Maker::make(x));
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(x);
+}
+
+#define BENCH_DELETERS(prefix, op, fn) \
+    bench::registrar{prefix "/" op "/stateless_lambda", &fn<stateless_lambda>}, \
+    bench::registrar{prefix "/" op "/capturing_lambda", &fn<capturing_lambda>}, \
+    bench::registrar{prefix "/" op "/function_pointer", &fn<function_pointer>}, \
+    bench::registrar{prefix "/" op "/std_function", &fn<std_function>}
+
+bench::registrar registrars[] = {
+    BENCH_DELETERS("manual_resource", "destroy", manual_destroy),
+    BENCH_DELETERS("manual_resource", "release", manual_release),
+    BENCH_DELETERS("unique_resource", "destroy", unique_resource_destroy),
+    BENCH_DELETERS("unique_resource", "reset", unique_resource_reset),
+    BENCH_DELETERS("unique_resource", "release", unique_resource_release),
+    BENCH_DELETERS("unique_resource", "move", unique_resource_move),
+    BENCH_DELETERS("unique_resource", "checked", unique_resource_checked),
+};
+
+} // namespace
@@ -0,0 +1,124 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include "bench.hpp"
+
+namespace {
+
+int last_closed = 0;
+
+void close_handle(int h) noexcept { last_closed = h; }
+
+using static_close = SCOPE_STATIC_DELETER(close_handle);
+using pointer_close = void (*)(int) noexcept;
+
+using fd_traits = scope::sentinel_traits<int, -1>;
+
+// A function pointer deleter is called indirectly: the pointer is loaded from
+// the unique_resource, which the compiler can not see through here.
+void function_pointer_reset(bench::state& state)
+{
+    scope::unique_resource<int, pointer_close> r{0, bench::opaque(&close_handle)};
+    for(auto i = state.iterations(); i; --i) {
+        r.reset(static_cast<int>(i));
+        bench::clobber_memory();
+    }
+    state.counter("bytes", sizeof(r));
+}
+
+void static_deleter_reset(bench::state& state)
+{
+    scope::unique_resource<int, static_close> r{0, static_close{}};
+    for(auto i = state.iterations(); i; --i) {
+        r.reset(static_cast<int>(i));
+        bench::clobber_memory();
+    }
+    state.counter("bytes", sizeof(r));
+}
+
+void function_pointer_destroy(bench::state& state)
+{
+    auto d = bench::opaque(&close_handle);
+    for(auto i = state.iterations(); i; --i) {
+        {
+            scope::unique_resource<int, pointer_close> r{static_cast<int>(i), d};
+        }
+        bench::clobber_memory();
+    }
+    state.counter("bytes", sizeof(scope::unique_resource<int, pointer_close>));
+}
+
+void static_deleter_destroy(bench::state& state)
+{
+    for(auto i = state.iterations(); i; --i) {
+        {
+            scope::unique_resource<int, static_close> r{static_cast<int>(i), static_close{}};
+        }
+        bench::clobber_memory();
+    }
+    state.counter("bytes", sizeof(scope::unique_resource<int, static_close>));
+}
+
+void sentinel_function_pointer_destroy(bench::state& state)
+{
+    auto d = bench::opaque(&close_handle);
+    for(auto i = state.iterations(); i; --i) {
+        {
+            scope::unique_sentinel_resource<int, pointer_close, fd_traits> r{static_cast<int>(i), d};
+        }
+        bench::clobber_memory();
+    }
+    state.counter("bytes", sizeof(scope::unique_sentinel_resource<int, pointer_close, fd_traits>));
+}
+
+void sentinel_static_deleter_destroy(bench::state& state)
+{
+    for(auto i = state.iterations(); i; --i) {
+        {
+            scope::unique_sentinel_resource<int, static_close, fd_traits> r{static_cast<int>(i), static_close{}};
+        }
+        bench::clobber_memory();
+    }
+    state.counter("bytes", sizeof(scope::unique_sentinel_resource<int, static_close, fd_traits>));
+}
+
+void manual_destroy(bench::state& state)
+{
+    for(auto i = state.iterations(); i; --i) {
+        close_handle(static_cast<int>(i));
+        bench::clobber_memory();
+    }
+    state.counter("bytes", sizeof(int));
+}
+
+bench::registrar registrars[] = {
+    {"static_deleter/manual/destroy", &manual_destroy},
+    {"static_deleter/unique_resource/reset/function_pointer", &function_pointer_reset},
+    {"static_deleter/unique_resource/reset/static_deleter", &static_deleter_reset},
+    {"static_deleter/unique_resource/destroy/function_pointer", &function_pointer_destroy},
+    {"static_deleter/unique_resource/destroy/static_deleter", &static_deleter_destroy},
+    {"static_deleter/unique_sentinel_resource/destroy/function_pointer", &sentinel_function_pointer_destroy},
+    {"static_deleter/unique_sentinel_resource/destroy/static_deleter", &sentinel_static_deleter_destroy},
+};
+
+} // namespace
@@ -0,0 +1,149 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include "bench.hpp"
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+
+namespace {
+
+// K nested steps, each one undone by its own scope_fail.
+template <int K>
+struct scope_fail_steps
+{
+    static void run(int* a, int v, bool fail)
+    {
+        const int old = a[K - 1];
+        a[K - 1] = v;
+        auto g = scope::make_scope_fail([a, old]{ a[K - 1] = old; });
+        scope_fail_steps<K - 1>::run(a, v, fail);
+    }
+};
+
+template <>
+struct scope_fail_steps<0>
+{
+    static void run(int*, int, bool fail)
+    {
+        if(fail) {
+            throw 42;
+        }
+    }
+};
+
+template <int K>
+void rollback_log_steps(scope::rollback_log<>& log, int* a, int v)
+{
+    for(int j = 0; j < K; ++j) {
+        const int old = a[j];
+        a[j] = v;
+        log.push([a, j, old]{ a[j] = old; });
+    }
+}
+
+template <int K>
+void scope_fail_commit(bench::state& state)
+{
+    int a[K] = {};
+    for(auto i = state.iterations(); i; --i) {
+        scope_fail_steps<K>::run(a, static_cast<int>(i), false);
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(a);
+}
+
+template <int K>
+void rollback_log_commit(bench::state& state)
+{
+    int a[K] = {};
+    for(auto i = state.iterations(); i; --i) {
+        scope::rollback_log<> log;
+        rollback_log_steps<K>(log, a, static_cast<int>(i));
+        log.commit();
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(a);
+}
+
+template <int K>
+void scope_fail_rollback(bench::state& state)
+{
+    int a[K] = {};
+    for(auto i = state.iterations(); i; --i) {
+        try {
+            scope_fail_steps<K>::run(a, static_cast<int>(i), true);
+        }
+        catch(int) {
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(a);
+}
+
+template <int K>
+void rollback_log_rollback(bench::state& state)
+{
+    int a[K] = {};
+    for(auto i = state.iterations(); i; --i) {
+        try {
+            scope::rollback_log<> log;
+            rollback_log_steps<K>(log, a, static_cast<int>(i));
+            throw 42;
+        }
+        catch(int) {
+        }
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(a);
+}
+
+// The failure is reported by a return value: no exception is thrown.
+template <int K>
+void rollback_log_explicit_rollback(bench::state& state)
+{
+    int a[K] = {};
+    for(auto i = state.iterations(); i; --i) {
+        scope::rollback_log<> log;
+        rollback_log_steps<K>(log, a, static_cast<int>(i));
+        log.rollback();
+        bench::clobber_memory();
+    }
+    bench::do_not_optimize(a);
+}
+
+bench::registrar registrars[] = {
+    {"rollback_log/commit/scope_fail/4", &scope_fail_commit<4>},
+    {"rollback_log/commit/rollback_log/4", &rollback_log_commit<4>},
+    {"rollback_log/commit/scope_fail/16", &scope_fail_commit<16>},
+    {"rollback_log/commit/rollback_log/16", &rollback_log_commit<16>},
+    {"rollback_log/rollback/scope_fail/4", &scope_fail_rollback<4>},
+    {"rollback_log/rollback/rollback_log/4", &rollback_log_rollback<4>},
+    {"rollback_log/rollback/scope_fail/16", &scope_fail_rollback<16>},
+    {"rollback_log/rollback/rollback_log/16", &rollback_log_rollback<16>},
+    {"rollback_log/explicit_rollback/rollback_log/4", &rollback_log_explicit_rollback<4>},
+    {"rollback_log/explicit_rollback/rollback_log/16", &rollback_log_explicit_rollback<16>},
+};
+
+} // namespace
+
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
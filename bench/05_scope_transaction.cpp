@@ -0,0 +1,109 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include "bench.hpp"
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+
+namespace {
+
+// K nested actions alternating between scope_success and scope_fail, each
+// one taking its own uncaught exception snapshot. Each action is followed by
+// opaque work, as in real code: otherwise the compiler may merge the calls of
+// std::uncaught_exceptions(), which is declared pure.
+template <int K>
+struct guard_actions
+{
+    static void run(int* a)
+    {
+        auto g = scope::make_scope_success([a]{ ++a[K - 1]; });
+        bench::clobber_memory();
+        auto g2 = scope::make_scope_fail([a]{ --a[K - 1]; });
+        bench::clobber_memory();
+        guard_actions<K - 2>::run(a);
+    }
+};
+
+template <>
+struct guard_actions<0>
+{
+    static void run(int*) {}
+};
+
+template <int K>
+void transaction_actions(scope::scope_transaction<K>& t, int* a)
+{
+    for(int j = 0; j < K; j += 2) {
+        t.on_success([a, j]{ ++a[j]; });
+        bench::clobber_memory();
+        t.on_fail([a, j]{ --a[j]; });
+        bench::clobber_memory();
+    }
+}
+
+void count_calls(bench::state& state, std::uint64_t before)
+{
+    if(bench::uncaught_exceptions_counted()) {
+        state.counter("uncaught_exceptions_calls", double(bench::uncaught_exceptions_calls() - before) / state.iterations());
+    }
+}
+
+template <int K>
+void guards(bench::state& state)
+{
+    int a[K] = {};
+    auto before = bench::uncaught_exceptions_calls();
+    for(auto i = state.iterations(); i; --i) {
+        guard_actions<K>::run(a);
+        bench::clobber_memory();
+    }
+    count_calls(state, before);
+    bench::do_not_optimize(a);
+}
+
+template <int K>
+void transaction(bench::state& state)
+{
+    int a[K] = {};
+    auto before = bench::uncaught_exceptions_calls();
+    for(auto i = state.iterations(); i; --i) {
+        {
+            scope::scope_transaction<K> t;
+            transaction_actions<K>(t, a);
+        }
+        bench::clobber_memory();
+    }
+    count_calls(state, before);
+    bench::do_not_optimize(a);
+}
+
+bench::registrar registrars[] = {
+    {"scope_transaction/guards/4", &guards<4>},
+    {"scope_transaction/transaction/4", &transaction<4>},
+    {"scope_transaction/guards/12", &guards<12>},
+    {"scope_transaction/transaction/12", &transaction<12>},
+};
+
+} // namespace
+
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
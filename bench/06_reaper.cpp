@@ -0,0 +1,165 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/reaper.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace {
+
+// Latency of reset() on the calling thread, sampled one operation at a time.
+// ns/op also includes acquiring the resource.
+class latency
+{
+public:
+    explicit latency(std::uint64_t iterations)
+    {
+        samples_.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(iterations, max_samples)));
+    }
+
+    template <typename F>
+    void measure(F&& f)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        f();
+        const auto t1 = std::chrono::steady_clock::now();
+        if(samples_.size() < max_samples) {
+            samples_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        }
+    }
+
+    void report(bench::state& state)
+    {
+        std::sort(samples_.begin(), samples_.end());
+        state.counter("p50_ns", percentile(0.5));
+        state.counter("p99_ns", percentile(0.99));
+        state.counter("p99.9_ns", percentile(0.999));
+        state.counter("max_ns", samples_.empty() ? 0.0 : double(samples_.back()));
+    }
+
+private:
+    static constexpr std::size_t max_samples = std::size_t(1) << 20;
+
+    double percentile(double p) const
+    {
+        if(samples_.empty()) {
+            return 0.0;
+        }
+        return double(samples_[static_cast<std::size_t>(p * double(samples_.size() - 1))]);
+    }
+
+    std::vector<std::int64_t> samples_;
+};
+
+struct close_fd
+{
+    void operator()(int fd) const noexcept { ::close(fd); }
+};
+
+struct mapping
+{
+    void* addr;
+    std::size_t size;
+};
+
+struct unmap
+{
+    void operator()(const mapping& m) const noexcept { ::munmap(m.addr, m.size); }
+};
+
+constexpr std::size_t mapping_size = 1 << 20;
+
+int null_fd()
+{
+    static int fd = ::open("/dev/null", O_RDONLY);
+    return fd;
+}
+
+mapping map_touched()
+{
+    void* p = ::mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    for(std::size_t off = 0; off < mapping_size; off += 4096) {
+        static_cast<char*>(p)[off] = 1;
+    }
+    return mapping{p, mapping_size};
+}
+
+struct inline_deleter
+{
+    template <typename D>
+    static D make(const D& d) { return d; }
+};
+
+struct deferred
+{
+    static scope::reaper& get()
+    {
+        static scope::reaper r{4096, scope::reaper_overflow::run_inline};
+        return r;
+    }
+
+    template <typename D>
+    static scope::deferred_deleter<D> make(const D& d) { return scope::deferred_deleter<D>{d, get()}; }
+};
+
+template <typename Mode>
+void close(bench::state& state)
+{
+    latency lat{state.iterations()};
+    const auto d = Mode::make(close_fd{});
+    for(auto i = state.iterations(); i; --i) {
+        scope::unique_resource<int, decltype(d)> fd{::dup(null_fd()), d};
+        lat.measure([&fd]{ fd.reset(); });
+    }
+    deferred::get().flush();
+    lat.report(state);
+}
+
+template <typename Mode>
+void munmap(bench::state& state)
+{
+    latency lat{state.iterations()};
+    const auto d = Mode::make(unmap{});
+    for(auto i = state.iterations(); i; --i) {
+        scope::unique_resource<mapping, decltype(d)> m{map_touched(), d};
+        lat.measure([&m]{ m.reset(); });
+    }
+    deferred::get().flush();
+    lat.report(state);
+}
+
+bench::registrar registrars[] = {
+    {"reaper/close/inline", &close<inline_deleter>},
+    {"reaper/close/deferred", &close<deferred>},
+    {"reaper/munmap_1MiB/inline", &munmap<inline_deleter>},
+    {"reaper/munmap_1MiB/deferred", &munmap<deferred>},
+};
+
+} // namespace
@@ -0,0 +1,105 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/uring_close.hpp"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace {
+
+struct close_fd
+{
+    void operator()(int fd) const noexcept { ::close(fd); }
+};
+
+struct flush_none
+{
+    static void flush() noexcept {}
+};
+
+struct flush_uring
+{
+    static void flush() noexcept { scope::uring_close_flush(); }
+};
+
+// Raises the soft limit of open fds to the hard limit. False if that is not
+// enough for n more fds.
+bool reserve_fds(std::size_t n)
+{
+    rlimit rl;
+    if(::getrlimit(RLIMIT_NOFILE, &rl) != 0) {
+        return false;
+    }
+    rl.rlim_cur = rl.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &rl);
+    return rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur >= n + 64;
+}
+
+// Tears down N fds held in unique_resource<int, D>. ns/op includes opening
+// them; teardown_us covers the destructors and the final flush only.
+template <std::size_t N, typename D, typename Flush>
+void teardown(bench::state& state)
+{
+    if(!reserve_fds(N)) {
+        state.counter("skipped_rlimit_nofile", 1);
+        return;
+    }
+    const int null_fd = ::open("/dev/null", O_RDONLY);
+    double teardown_ns = 0;
+    std::uint64_t syscalls = 0;
+    for(auto i = state.iterations(); i; --i) {
+        std::vector<scope::unique_resource<int, D>> fds;
+        fds.reserve(N);
+        for(std::size_t j = 0; j < N; ++j) {
+            fds.emplace_back(::dup(null_fd), D{});
+        }
+        const auto before = bench::syscalls();
+        const auto t0 = std::chrono::steady_clock::now();
+        fds.clear();
+        Flush::flush();
+        const auto t1 = std::chrono::steady_clock::now();
+        syscalls += bench::syscalls() - before;
+        teardown_ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+    }
+    ::close(null_fd);
+    state.counter("teardown_us", teardown_ns / 1e3 / state.iterations());
+    if(bench::syscalls_counted()) {
+        state.counter("syscalls_per_teardown", double(syscalls) / state.iterations());
+    }
+    state.counter("io_uring", scope::uring_close_available() ? 1 : 0);
+}
+
+bench::registrar registrars[] = {
+    {"uring_close/teardown/close/10000", &teardown<10000, close_fd, flush_none>},
+    {"uring_close/teardown/uring_close/10000", &teardown<10000, scope::uring_close, flush_uring>},
+    {"uring_close/teardown/close/100000", &teardown<100000, close_fd, flush_none>},
+    {"uring_close/teardown/uring_close/100000", &teardown<100000, scope::uring_close, flush_uring>},
+};
+
+} // namespace
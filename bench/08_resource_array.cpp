@@ -0,0 +1,139 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace {
+
+struct close_fd
+{
+    void operator()(int fd) const noexcept { ::close(fd); }
+};
+
+// A batch deleter: closes each run of consecutive fds with one close_range().
+struct close_fds
+{
+    void operator()(int* fds, std::size_t n) const noexcept
+    {
+        std::sort(fds, fds + n);
+        for(std::size_t i = 0; i < n;) {
+            std::size_t j = i + 1;
+            while(j < n && fds[j] == fds[j - 1] + 1) {
+                ++j;
+            }
+            close_run(fds[i], fds[j - 1]);
+            i = j;
+        }
+    }
+
+    static void close_run(int first, int last) noexcept
+    {
+#if defined(__NR_close_range)
+        if(::syscall(__NR_close_range, first, last, 0) == 0) {
+            return;
+        }
+#endif
+        for(int fd = first; fd <= last; ++fd) {
+            ::close(fd);
+        }
+    }
+};
+
+struct vector_of_unique_resource
+{
+    using type = std::vector<scope::unique_resource<int, close_fd>>;
+    static void add(type& v, int fd) { v.emplace_back(fd, close_fd{}); }
+    static constexpr double bytes_per_handle = sizeof(scope::unique_resource<int, close_fd>);
+};
+
+template <typename D>
+struct array_of
+{
+    using type = scope::unique_resource_array<int, D>;
+    static void add(type& a, int fd) { a.push_back(fd); }
+    static constexpr double bytes_per_handle = sizeof(int) + 1.0 / CHAR_BIT;
+};
+
+bool reserve_fds(std::size_t n)
+{
+    rlimit rl;
+    if(::getrlimit(RLIMIT_NOFILE, &rl) != 0) {
+        return false;
+    }
+    rl.rlim_cur = rl.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &rl);
+    return rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur >= n + 64;
+}
+
+// Tears down N fds. ns/op includes opening them; teardown_us covers the
+// destructor only.
+template <std::size_t N, typename Owner>
+void teardown(bench::state& state)
+{
+    if(!reserve_fds(N)) {
+        state.counter("skipped_rlimit_nofile", 1);
+        return;
+    }
+    const int null_fd = ::open("/dev/null", O_RDONLY);
+    double teardown_ns = 0;
+    std::uint64_t syscalls = 0;
+    for(auto i = state.iterations(); i; --i) {
+        std::chrono::steady_clock::time_point t0;
+        std::uint64_t before;
+        {
+            typename Owner::type fds;
+            for(std::size_t j = 0; j < N; ++j) {
+                Owner::add(fds, ::dup(null_fd));
+            }
+            before = bench::syscalls();
+            t0 = std::chrono::steady_clock::now();
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+        syscalls += bench::syscalls() - before;
+        teardown_ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+    }
+    ::close(null_fd);
+    state.counter("teardown_us", teardown_ns / 1e3 / state.iterations());
+    state.counter("bytes_per_handle", Owner::bytes_per_handle);
+    if(bench::syscalls_counted()) {
+        state.counter("syscalls_per_teardown", double(syscalls) / state.iterations());
+    }
+}
+
+bench::registrar registrars[] = {
+    {"resource_array/teardown/vector_of_unique_resource/10000", &teardown<10000, vector_of_unique_resource>},
+    {"resource_array/teardown/unique_resource_array/10000", &teardown<10000, array_of<close_fd>>},
+    {"resource_array/teardown/unique_resource_array_batch/10000", &teardown<10000, array_of<close_fds>>},
+};
+
+} // namespace
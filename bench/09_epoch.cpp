@@ -0,0 +1,99 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/epoch.hpp"
+
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "bench.hpp"
+
+#if defined(__cpp_lib_shared_mutex)
+
+namespace {
+
+struct epoch_read
+{
+    std::atomic<const int*> current{&value};
+    int value = 42;
+
+    int read()
+    {
+        scope::epoch_guard g;
+        return *current.load(std::memory_order_acquire);
+    }
+};
+
+struct shared_mutex_read
+{
+    std::shared_mutex mutex;
+    const int* current = &value;
+    int value = 42;
+
+    int read()
+    {
+        std::shared_lock<std::shared_mutex> lock{mutex};
+        return *current;
+    }
+};
+
+// Each of Readers threads makes state.iterations() reads: ns/op is the read
+// side cost seen by one reader while the others read concurrently.
+template <typename Reader, int Readers>
+void read_side(bench::state& state)
+{
+    Reader reader;
+    std::atomic<int> ready{0};
+    std::vector<std::thread> threads;
+    for(int t = 0; t < Readers; ++t) {
+        threads.emplace_back([&]{
+            ++ready;
+            while(ready < Readers) {
+                std::this_thread::yield();
+            }
+            int sum = 0;
+            for(auto i = state.iterations(); i; --i) {
+                sum += reader.read();
+            }
+            bench::do_not_optimize(sum);
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    state.counter("readers", Readers);
+    state.counter("hardware_threads", std::thread::hardware_concurrency());
+}
+
+bench::registrar registrars[] = {
+    {"epoch/read/epoch_guard/1", &read_side<epoch_read, 1>},
+    {"epoch/read/shared_mutex/1", &read_side<shared_mutex_read, 1>},
+    {"epoch/read/epoch_guard/2", &read_side<epoch_read, 2>},
+    {"epoch/read/shared_mutex/2", &read_side<shared_mutex_read, 2>},
+    {"epoch/read/epoch_guard/4", &read_side<epoch_read, 4>},
+    {"epoch/read/shared_mutex/4", &read_side<shared_mutex_read, 4>},
+};
+
+} // namespace
+
+#endif // defined(__cpp_lib_shared_mutex)
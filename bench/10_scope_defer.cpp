@@ -0,0 +1,126 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace {
+
+// A buffer pool with a free list, and a statistic shared by its users: the
+// cleanup of a request returns its buffer and updates the statistic.
+struct pool
+{
+    std::vector<void*> free_list;
+    std::int64_t in_use = 0;
+    std::vector<char> buffers;
+
+    explicit pool(std::size_t n)
+        : buffers(n * 64)
+    {
+        for(std::size_t i = 0; i < n; ++i) {
+            free_list.push_back(&buffers[i * 64]);
+        }
+    }
+
+    void* get()
+    {
+        void* p = free_list.back();
+        free_list.pop_back();
+        ++in_use;
+        return p;
+    }
+
+    void put(void* p)
+    {
+        free_list.push_back(p);
+        --in_use;
+    }
+};
+
+// Work done by a request between acquiring and releasing its buffer: it
+// touches Touch bytes of a large data set, a different part each time, which
+// evicts the pool from the cache as requests go on.
+template <std::size_t Touch>
+struct request_work
+{
+    static constexpr std::size_t data_size = Touch ? std::size_t(8) << 20 : 64;
+    std::vector<char> data = std::vector<char>(data_size);
+    std::size_t offset = 0;
+
+    void run(void* buffer)
+    {
+        for(std::size_t i = 0; i < Touch; i += 64) {
+            data[offset + i] = static_cast<char>(data[offset + i] + 1);
+        }
+        offset = (offset + Touch) % data_size;
+        static_cast<char*>(buffer)[0] = 1;
+        bench::clobber_memory();
+    }
+};
+
+struct immediate
+{
+    template <typename F>
+    static scope::scope_exit<F> guard(F f) { return scope::scope_exit<F>(std::move(f)); }
+    static void quiescent() {}
+};
+
+struct deferred
+{
+    template <typename F>
+    static scope::scope_defer<F> guard(F f) { return scope::make_scope_defer(std::move(f)); }
+    static void quiescent() { scope::defer_flush(); }
+};
+
+// One request per iteration. The event loop reaches a quiescent point every
+// 256 requests.
+template <typename Mode, std::size_t Touch>
+void requests(bench::state& state)
+{
+    pool p{1024};
+    request_work<Touch> work;
+    std::uint64_t n = 0;
+    for(auto i = state.iterations(); i; --i) {
+        void* buffer = p.get();
+        auto g = Mode::guard([&p, buffer]{ p.put(buffer); });
+        work.run(buffer);
+        if(++n % 256 == 0) {
+            Mode::quiescent();
+        }
+    }
+    scope::defer_flush();
+    bench::do_not_optimize(p.in_use);
+}
+
+bench::registrar registrars[] = {
+    {"scope_defer/requests/immediate/hot", &requests<immediate, 0>},
+    {"scope_defer/requests/deferred/hot", &requests<deferred, 0>},
+    {"scope_defer/requests/immediate/touch_4KiB", &requests<immediate, 4096>},
+    {"scope_defer/requests/deferred/touch_4KiB", &requests<deferred, 4096>},
+    {"scope_defer/requests/immediate/touch_32KiB", &requests<immediate, 32 * 1024>},
+    {"scope_defer/requests/deferred/touch_32KiB", &requests<deferred, 32 * 1024>},
+};
+
+} // namespace
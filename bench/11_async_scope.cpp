@@ -0,0 +1,139 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/async_scope.hpp"
+
+#if defined(SCOPE_USE_COROUTINE)
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <new>
+
+#include "bench.hpp"
+#include "task.hpp"
+
+namespace {
+
+std::uint64_t allocations = 0;
+std::size_t allocation_sizes[8];
+
+} // namespace
+
+// Counts heap allocations, to tell where coroutine frames live.
+void* operator new(std::size_t n)
+{
+    allocation_sizes[allocations++ % 8] = n;
+    if(void* p = std::malloc(n ? n : 1)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using helper::task;
+
+int done = 0;
+
+// A body and a cleanup which complete without suspending: what is measured
+// is the cost of starting, suspending and resuming around them.
+task<int> work(int i) { co_return i; }
+task<> flush() { ++done; co_return; }
+
+// No cleanup on the exception path.
+task<int> unguarded(int i)
+{
+    int r = co_await work(i);
+    co_await flush();
+    co_return r;
+}
+
+// What async_scope_exit does, by hand.
+task<int> try_catch(int i)
+{
+    std::exception_ptr error;
+    int r = 0;
+    try {
+        r = co_await work(i);
+    }
+    catch(...) {
+        error = std::current_exception();
+    }
+    co_await flush();
+    if(error) {
+        std::rethrow_exception(error);
+    }
+    co_return r;
+}
+
+template <std::size_t FrameSize, scope::async_frame_overflow Overflow = scope::async_frame_overflow::fail>
+task<int> guarded(int i)
+{
+    co_return co_await scope::async_scope_exit<FrameSize, Overflow>([i]{ return work(i); }, []{ return flush(); });
+}
+
+template <task<int> (*F)(int)>
+void resume(bench::state& state)
+{
+    int sum = 0;
+    const auto before = allocations;
+    for(auto i = state.iterations(); i; --i) {
+        sum += F(static_cast<int>(i)).run();
+    }
+    state.counter("heap_allocations_per_op", double(allocations - before) / state.iterations());
+    bench::do_not_optimize(sum);
+}
+
+// The frame of run_guarded, measured by forcing it to the heap: it is
+// allocated right after the frame of the awaiting coroutine.
+void frame_size(bench::state& state)
+{
+    auto body = []{ return work(1); };
+    auto ef = []{ return flush(); };
+    std::size_t frame = 0;
+    for(auto i = state.iterations(); i; --i) {
+        auto outer = [&]() -> task<int> {
+            co_return co_await scope::async_scope_exit<1, scope::async_frame_overflow::heap>(body, ef);
+        };
+        const auto first = allocations;
+        bench::do_not_optimize(outer().run());
+        frame = allocation_sizes[(first + 1) % 8] - sizeof(scope::detail::frame_header);
+    }
+    state.counter("run_guarded_frame_bytes", double(frame));
+    state.counter("awaitable_bytes", double(sizeof(decltype(scope::async_scope_exit(body, ef)))));
+    state.counter("frame_buffer_bytes", double(scope::default_async_frame_size));
+}
+
+bench::registrar registrars[] = {
+    {"async_scope/resume/unguarded", &resume<&unguarded>},
+    {"async_scope/resume/try_catch", &resume<&try_catch>},
+    {"async_scope/resume/async_scope_exit", &resume<&guarded<scope::default_async_frame_size>>},
+    {"async_scope/resume/async_scope_exit_heap_frame", &resume<&guarded<1, scope::async_frame_overflow::heap>>},
+    {"async_scope/frame_size", &frame_size},
+};
+
+} // namespace
+
+#endif // defined(SCOPE_USE_COROUTINE)
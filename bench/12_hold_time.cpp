@@ -0,0 +1,78 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/histogram.hpp"
+
+#include "bench.hpp"
+
+namespace {
+
+int last_closed = 0;
+
+struct close_handle
+{
+    void operator()(int h) const noexcept { last_closed = h; }
+};
+
+// reset(r) calls the deleter on the old resource and acquires the new one:
+// one timestamp and one record() per iteration with hold_time.
+template <typename Policy>
+void reset(bench::state& state)
+{
+    scope::unique_resource<int, close_handle, Policy> r{0, close_handle{}};
+    for(auto i = state.iterations(); i; --i) {
+        r.reset(static_cast<int>(i));
+        bench::clobber_memory();
+    }
+    state.counter("bytes", sizeof(r));
+}
+
+void record(bench::state& state)
+{
+    scope::histogram h;
+    for(auto i = state.iterations(); i; --i) {
+        h.record(i);
+        bench::clobber_memory();
+    }
+}
+
+void snapshot(bench::state& state)
+{
+    scope::histogram h;
+    h.record(1);
+    scope::histogram_snapshot s;
+    for(auto i = state.iterations(); i; --i) {
+        h.snapshot(s);
+        bench::do_not_optimize(s);
+    }
+}
+
+bench::registrar registrars[] = {
+    {"hold_time/reset/null_resource_policy", &reset<scope::null_resource_policy>},
+    {"hold_time/reset/steady_ticks", &reset<scope::hold_time<void, scope::steady_ticks>>},
+#if defined(__x86_64__) || defined(__i386__)
+    {"hold_time/reset/tsc_ticks", &reset<scope::hold_time<void, scope::tsc_ticks>>},
+#endif
+    {"hold_time/histogram/record", &record},
+    {"hold_time/histogram/snapshot", &snapshot},
+};
+
+} // namespace
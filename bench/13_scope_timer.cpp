@@ -0,0 +1,117 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/timer.hpp"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace {
+
+SCOPE_TIMER_REGION(bench_region, "bench");
+
+void work(std::uint64_t i)
+{
+    bench::do_not_optimize(i);
+}
+
+void untimed(bench::state& state)
+{
+    for(auto i = state.iterations(); i; --i) {
+        work(i);
+        bench::clobber_memory();
+    }
+}
+
+template <typename Clock>
+void clock_now(bench::state& state)
+{
+    for(auto i = state.iterations(); i; --i) {
+        auto t = Clock::now();
+        bench::do_not_optimize(t);
+    }
+}
+
+template <typename Clock>
+void timer(bench::state& state)
+{
+    for(auto i = state.iterations(); i; --i) {
+        auto t = scope::make_scope_timer<bench_region, Clock>();
+        work(i);
+        bench::clobber_memory();
+    }
+}
+
+// The hand-rolled timer: a scope_exit which records into a map shared by
+// every thread, under a mutex.
+std::mutex regions_mutex;
+std::map<std::string, std::vector<std::uint64_t>> regions;
+
+void record(const char* name, std::uint64_t v)
+{
+    std::lock_guard<std::mutex> lock{regions_mutex};
+    auto& buckets = regions[name];
+    if(buckets.empty()) {
+        buckets.resize(scope::histogram_snapshot::buckets);
+    }
+    ++buckets[scope::histogram_snapshot::bucket_of(v)];
+}
+
+void mutex_map(bench::state& state)
+{
+    for(auto i = state.iterations(); i; --i) {
+        const auto start = scope::steady_ticks::now();
+        auto t = scope::make_scope_exit([start]{ record("bench", scope::steady_ticks::now() - start); });
+        work(i);
+        bench::clobber_memory();
+    }
+}
+
+void report_json(bench::state& state)
+{
+    {
+        auto t = scope::make_scope_timer<bench_region>();
+    }
+    std::size_t bytes = 0;
+    for(auto i = state.iterations(); i; --i) {
+        bytes += scope::timer_report_json().size();
+    }
+    bench::do_not_optimize(bytes);
+}
+
+bench::registrar registrars[] = {
+    {"scope_timer/untimed", &untimed},
+    {"scope_timer/clock/steady_ticks", &clock_now<scope::steady_ticks>},
+    {"scope_timer/timer/steady_ticks", &timer<scope::steady_ticks>},
+    {"scope_timer/mutex_map/steady_ticks", &mutex_map},
+#if defined(__x86_64__) || defined(__i386__)
+    {"scope_timer/clock/tsc_ticks", &clock_now<scope::tsc_ticks>},
+    {"scope_timer/timer/tsc_ticks", &timer<scope::tsc_ticks>},
+#endif
+    {"scope_timer/report_json", &report_json},
+};
+
+} // namespace
@@ -0,0 +1,51 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#define SCOPE_ENABLE_LIVE_REGISTRY
+#include "live_registry.hpp"
+
+namespace {
+
+// A snapshot of the whole table, with 1000 live resources in it.
+void snapshot(bench::state& state)
+{
+    std::vector<scope::unique_resource<int, live_registry_bench::close_handle>> open;
+    open.reserve(1000);
+    for(int i = 0; i < 1000; ++i) {
+        open.push_back(scope::unique_resource<int, live_registry_bench::close_handle>{i, live_registry_bench::close_handle{}});
+    }
+    std::vector<scope::live_resource> out;
+    for(auto i = state.iterations(); i; --i) {
+        scope::live_resources_snapshot(out);
+        bench::do_not_optimize(out);
+    }
+    state.counter("live", static_cast<double>(out.size()));
+}
+
+bench::registrar registrars[] = {
+    {"live_registry/churn/registered/1", &live_registry_bench::churn<1>},
+    {"live_registry/churn/registered/2", &live_registry_bench::churn<2>},
+    {"live_registry/churn/registered/4", &live_registry_bench::churn<4>},
+    {"live_registry/churn/registered/8", &live_registry_bench::churn<8>},
+    {"live_registry/snapshot/1000", &snapshot},
+};
+
+} // namespace
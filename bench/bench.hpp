@@ -0,0 +1,126 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_BENCH_HPP_
+#define NAKATT_BENCH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// Keep `value` alive in a register or memory so that the optimizer can not
+// delete the computation which produced it.
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Hide `value` from the optimizer, e.g. to turn a known function pointer into
+// an opaque one.
+template <typename T>
+inline T opaque(T value)
+{
+    asm volatile("" : "+r"(value) : : "memory");
+    return value;
+}
+
+inline void clobber_memory()
+{
+    asm volatile("" : : : "memory");
+}
+
+class state
+{
+public:
+    explicit state(std::uint64_t iterations) noexcept
+        : iterations_{iterations}
+    {}
+
+    std::uint64_t iterations() const noexcept { return iterations_; }
+
+    // Attach a named value to the result, e.g. a per-operation event count.
+    void counter(const std::string& name, double value)
+    {
+        for(auto& c : counters_) {
+            if(c.first == name) {
+                c.second = value;
+                return;
+            }
+        }
+        counters_.emplace_back(name, value);
+    }
+
+    const std::vector<std::pair<std::string, double>>& counters() const noexcept { return counters_; }
+
+private:
+    std::uint64_t iterations_;
+    std::vector<std::pair<std::string, double>> counters_;
+};
+
+// Number of std::uncaught_exceptions() calls so far. It counts only if the
+// benchmark is linked with BENCH_LDFLAGS wrapping std::uncaught_exceptions(),
+// see uncaught_exceptions_counted().
+std::uint64_t uncaught_exceptions_calls() noexcept;
+bool uncaught_exceptions_counted() noexcept;
+
+// Number of close() and syscall() calls made by the benchmark so far, counted
+// the same way.
+std::uint64_t syscalls() noexcept;
+bool syscalls_counted() noexcept;
+
+using function = void (*)(state&);
+
+struct entry
+{
+    const char* name;
+    function fn;
+};
+
+inline std::vector<entry>& registry()
+{
+    static std::vector<entry> entries;
+    return entries;
+}
+
+struct registrar
+{
+    registrar(const char* name, function fn)
+    {
+        registry().push_back(entry{name, fn});
+    }
+};
+
+} // namespace bench
+
+#define BENCH_CAT_(a, b) a##b
+#define BENCH_CAT(a, b) BENCH_CAT_(a, b)
+
+#define BENCH(name) \
+    static void BENCH_CAT(bench_fn_, __LINE__)(::bench::state&); \
+    static ::bench::registrar BENCH_CAT(bench_reg_, __LINE__){name, &BENCH_CAT(bench_fn_, __LINE__)}; \
+    static void BENCH_CAT(bench_fn_, __LINE__)(::bench::state& state)
+
+#endif // NAKATT_BENCH_HPP_
@@ -0,0 +1,81 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_SCOPE_BENCH_LIVE_REGISTRY_HPP_
+#define NAKATT_SCOPE_BENCH_LIVE_REGISTRY_HPP_
+
+// The workload of the live registry benchmarks, built once with the
+// registry in 14_live_registry.cpp and once without it in
+// live_registry_off.cpp: the option changes unique_resource in the whole
+// translation unit.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "scope/scope.hpp"
+
+#include "bench.hpp"
+
+// In an unnamed namespace: each translation unit has its own churn().
+namespace live_registry_bench {
+namespace {
+
+struct close_handle
+{
+    void operator()(int h) const noexcept { bench::do_not_optimize(h); }
+};
+
+// Each of Threads threads keeps 16 handles open and replaces one of them
+// state.iterations() times, by reset(r): one leave and one join each. ns/op
+// is the cost seen by one thread while the others churn concurrently.
+template <int Threads>
+void churn(bench::state& state)
+{
+    std::atomic<int> ready{0};
+    std::vector<std::thread> threads;
+    for(int t = 0; t < Threads; ++t) {
+        threads.emplace_back([&]{
+            scope::unique_resource<int, close_handle> open[16];
+            for(auto& r : open) {
+                r.reset(0);
+            }
+            ++ready;
+            while(ready < Threads) {
+                std::this_thread::yield();
+            }
+            for(auto i = state.iterations(); i; --i) {
+                open[i % 16].reset(static_cast<int>(i));
+                bench::clobber_memory();
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    state.counter("threads", Threads);
+    state.counter("hardware_threads", std::thread::hardware_concurrency());
+}
+
+} // namespace
+} // namespace live_registry_bench
+
+#endif // NAKATT_SCOPE_BENCH_LIVE_REGISTRY_HPP_
@@ -0,0 +1,231 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace {
+
+struct options
+{
+    std::string filter;
+    std::string out;
+    double min_time = 0.2;
+    int repetitions = 5;
+};
+
+struct result
+{
+    std::string name;
+    std::uint64_t iterations;
+    std::vector<double> ns_per_op;
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+double run_once(const bench::entry& e, std::uint64_t iterations, bench::state& st)
+{
+    st = bench::state{iterations};
+    auto start = std::chrono::steady_clock::now();
+    e.fn(st);
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+result run(const bench::entry& e, const options& opt)
+{
+    bench::state st{1};
+
+    // Grow the iteration count until one repetition takes at least min_time.
+    std::uint64_t iterations = 1;
+    for(;;) {
+        double elapsed = run_once(e, iterations, st);
+        if(elapsed >= opt.min_time || iterations >= (std::uint64_t(1) << 40)) {
+            break;
+        }
+        double scale = elapsed > 0 ? opt.min_time / elapsed * 1.2 : 10.0;
+        scale = std::min(std::max(scale, 2.0), 10.0);
+        iterations = static_cast<std::uint64_t>(iterations * scale);
+    }
+
+    result r{e.name, iterations, {}, {}};
+    for(int i = 0; i < opt.repetitions; ++i) {
+        double elapsed = run_once(e, iterations, st);
+        r.ns_per_op.push_back(elapsed * 1e9 / iterations);
+    }
+    r.counters = st.counters();
+    return r;
+}
+
+std::string escape(const std::string& s)
+{
+    std::string out;
+    for(char c : s) {
+        if(c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    std::size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+double mean(const std::vector<double>& v)
+{
+    double sum = 0;
+    for(double x : v) {
+        sum += x;
+    }
+    return sum / v.size();
+}
+
+void write_json(std::ostream& os, const std::vector<result>& results, const options& opt)
+{
+    char buf[64];
+    auto num = [&buf](double v) -> const char* {
+        std::snprintf(buf, sizeof(buf), "%.4f", v);
+        return buf;
+    };
+
+    os << "{\n";
+    os << "  \"context\": {\n";
+    os << "    \"library\": \"scope-cpp11\",\n";
+    os << "    \"version\": \"" << SCOPE_VERSION << "\",\n";
+#if defined(__VERSION__)
+    os << "    \"compiler\": \"" << escape(__VERSION__) << "\",\n";
+#endif
+    os << "    \"cplusplus\": " << __cplusplus << ",\n";
+    os << "    \"min_time\": " << num(opt.min_time) << ",\n";
+    os << "    \"repetitions\": " << opt.repetitions << "\n";
+    os << "  },\n";
+    os << "  \"benchmarks\": [";
+    for(std::size_t i = 0; i < results.size(); ++i) {
+        const result& r = results[i];
+        os << (i ? ",\n" : "\n");
+        os << "    {\n";
+        os << "      \"name\": \"" << escape(r.name) << "\",\n";
+        os << "      \"iterations\": " << r.iterations << ",\n";
+        os << "      \"ns_per_op_min\": " << num(*std::min_element(r.ns_per_op.begin(), r.ns_per_op.end())) << ",\n";
+        os << "      \"ns_per_op_median\": " << num(median(r.ns_per_op)) << ",\n";
+        os << "      \"ns_per_op_mean\": " << num(mean(r.ns_per_op)) << ",\n";
+        os << "      \"counters\": {";
+        for(std::size_t j = 0; j < r.counters.size(); ++j) {
+            os << (j ? ", " : "") << "\"" << escape(r.counters[j].first) << "\": " << num(r.counters[j].second);
+        }
+        os << "}\n";
+        os << "    }";
+    }
+    os << "\n  ]\n";
+    os << "}\n";
+}
+
+bool parse_option(const char* arg, const char* name, std::string& value)
+{
+    std::size_t len = std::strlen(name);
+    if(std::strncmp(arg, name, len) == 0 && arg[len] == '=') {
+        value = arg + len + 1;
+        return true;
+    }
+    return false;
+}
+
+void usage(const char* argv0)
+{
+    std::cerr << "usage: " << argv0 << " [--filter=<substring>] [--min-time=<seconds>] [--repetitions=<n>] [--out=<file>] [--list]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    options opt;
+    bool list = false;
+    for(int i = 1; i < argc; ++i) {
+        std::string value;
+        if(parse_option(argv[i], "--filter", value)) {
+            opt.filter = value;
+        }
+        else if(parse_option(argv[i], "--out", value)) {
+            opt.out = value;
+        }
+        else if(parse_option(argv[i], "--min-time", value)) {
+            opt.min_time = std::atof(value.c_str());
+        }
+        else if(parse_option(argv[i], "--repetitions", value)) {
+            opt.repetitions = std::max(1, std::atoi(value.c_str()));
+        }
+        else if(std::strcmp(argv[i], "--list") == 0) {
+            list = true;
+        }
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<result> results;
+    for(const bench::entry& e : bench::registry()) {
+        if(!opt.filter.empty() && std::string(e.name).find(opt.filter) == std::string::npos) {
+            continue;
+        }
+        if(list) {
+            std::cout << e.name << "\n";
+            continue;
+        }
+        results.push_back(run(e, opt));
+        const result& r = results.back();
+        std::fprintf(stderr, "%-64s %10.3f ns/op\n", r.name.c_str(), median(r.ns_per_op));
+    }
+    if(list) {
+        return 0;
+    }
+
+    if(opt.out.empty()) {
+        write_json(std::cout, results, opt);
+    }
+    else {
+        std::ofstream ofs{opt.out};
+        write_json(ofs, results, opt);
+        if(!ofs) {
+            std::cerr << "failed to write " << opt.out << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
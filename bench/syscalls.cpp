@@ -0,0 +1,69 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <cstdint>
+
+#include <unistd.h>
+
+#include "bench.hpp"
+
+namespace {
+
+std::uint64_t calls = 0;
+
+} // namespace
+
+// With -Wl,--wrap=close,--wrap=syscall every close() and syscall() called from
+// the benchmark comes here first. syscall() passes its arguments in the
+// registers of a call with 7 long arguments on x86-64.
+extern "C" int __real_close(int fd) __attribute__((weak));
+extern "C" long __real_syscall(long n, ...) __attribute__((weak));
+
+extern "C" int __wrap_close(int fd)
+{
+    ++calls;
+    return __real_close(fd);
+}
+
+extern "C" long __wrap_syscall(long n, long a1, long a2, long a3, long a4, long a5, long a6)
+{
+    ++calls;
+    return __real_syscall(n, a1, a2, a3, a4, a5, a6);
+}
+
+namespace bench {
+
+std::uint64_t syscalls() noexcept
+{
+    return calls;
+}
+
+bool syscalls_counted() noexcept
+{
+    static const bool counted = [] {
+        std::uint64_t before = calls;
+        ::close(-1);
+        return calls != before;
+    }();
+    return counted;
+}
+
+} // namespace bench
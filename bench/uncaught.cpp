@@ -0,0 +1,67 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <cstdint>
+#include <exception>
+
+#include "bench.hpp"
+
+namespace {
+
+std::uint64_t calls = 0;
+
+} // namespace
+
+// With -Wl,--wrap=_ZSt19uncaught_exceptionsv every call of
+// std::uncaught_exceptions() from the benchmark comes here first.
+extern "C" int __real__ZSt19uncaught_exceptionsv() noexcept __attribute__((weak));
+
+extern "C" int __wrap__ZSt19uncaught_exceptionsv() noexcept
+{
+    ++calls;
+    return __real__ZSt19uncaught_exceptionsv();
+}
+
+namespace bench {
+
+std::uint64_t uncaught_exceptions_calls() noexcept
+{
+    return calls;
+}
+
+bool uncaught_exceptions_counted() noexcept
+{
+#if defined(__cpp_lib_uncaught_exceptions)
+    static const bool counted = [] {
+        std::uint64_t before = calls;
+        // std::uncaught_exceptions() is declared pure: keep the read of
+        // calls before the call.
+        clobber_memory();
+        do_not_optimize(std::uncaught_exceptions());
+        return calls != before;
+    }();
+    return counted;
+#else
+    return false;
+#endif
+}
+
+} // namespace bench
@@ -0,0 +1,6 @@
+# std::thread, used by scope/reaper.hpp
+LDFLAGS       = -pthread
+
+# Count std::uncaught_exceptions() calls and system calls in the benchmark,
+# see bench/uncaught.cpp and bench/syscalls.cpp
+BENCH_LDFLAGS = -Wl,--wrap=_ZSt19uncaught_exceptionsv -Wl,--wrap=close -Wl,--wrap=syscall
@@ -0,0 +1,270 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// Each guarded_<case> is compiled next to manual_<case>, the cleanup written
+// by hand, and check.sh compares their instruction counts. The functions
+// are only compiled, never linked: what they call is opaque to the
+// optimizer.
+#include "scope/scope.hpp"
+
+#include <utility>
+
+extern "C" {
+
+void close_fd(int fd) noexcept;
+void use(int fd) noexcept;
+void use_may_throw(int fd);
+int use_status(int fd) noexcept;
+bool use_failed(int fd) noexcept;
+
+} // extern "C"
+
+namespace {
+
+struct fd_closer
+{
+    void operator()(int fd) const noexcept { close_fd(fd); }
+};
+
+using fd_resource = scope::unique_resource<int, fd_closer>;
+
+} // namespace
+
+// The holder of one descriptor, as unique_resource<int, fd_closer> lays it
+// out.
+struct manual_fd
+{
+    int fd;
+    bool owns;
+};
+
+extern "C" {
+
+void guarded_scope_exit(int fd) noexcept
+{
+    auto g = scope::make_scope_exit([fd]{ close_fd(fd); });
+    use(fd);
+}
+
+void manual_scope_exit(int fd) noexcept
+{
+    use(fd);
+    close_fd(fd);
+}
+
+void guarded_scope_exit_throwing(int fd)
+{
+    auto g = scope::make_scope_exit([fd]{ close_fd(fd); });
+    use_may_throw(fd);
+}
+
+void manual_scope_exit_throwing(int fd)
+{
+    try {
+        use_may_throw(fd);
+    }
+    catch(...) {
+        close_fd(fd);
+        throw;
+    }
+    close_fd(fd);
+}
+
+void guarded_scope_exit_released(int fd, bool keep) noexcept
+{
+    auto g = scope::make_scope_exit([fd]{ close_fd(fd); });
+    use(fd);
+    if(keep) {
+        g.release();
+    }
+}
+
+void manual_scope_exit_released(int fd, bool keep) noexcept
+{
+    use(fd);
+    if(!keep) {
+        close_fd(fd);
+    }
+}
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+void guarded_scope_fail(int fd)
+{
+    auto g = scope::make_scope_fail([fd]{ close_fd(fd); });
+    use_may_throw(fd);
+}
+
+void manual_scope_fail(int fd)
+{
+    try {
+        use_may_throw(fd);
+    }
+    catch(...) {
+        close_fd(fd);
+        throw;
+    }
+}
+
+void guarded_scope_success(int fd)
+{
+    auto g = scope::make_scope_success([fd]{ close_fd(fd); });
+    use_may_throw(fd);
+}
+
+void manual_scope_success(int fd)
+{
+    use_may_throw(fd);
+    close_fd(fd);
+}
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+
+int guarded_scope_error(int fd) noexcept
+{
+    int err = 0;
+    auto g = scope::make_scope_error([fd]{ close_fd(fd); }, err);
+    err = use_status(fd);
+    return err;
+}
+
+int manual_scope_error(int fd) noexcept
+{
+    const int err = use_status(fd);
+    if(err) {
+        close_fd(fd);
+    }
+    return err;
+}
+
+void guarded_scope_flag(int fd) noexcept
+{
+    bool failed = false;
+    auto g = scope::make_scope_flag([fd]{ close_fd(fd); }, failed);
+    failed = use_failed(fd);
+}
+
+void manual_scope_flag(int fd) noexcept
+{
+    if(use_failed(fd)) {
+        close_fd(fd);
+    }
+}
+
+void guarded_unique_resource(int fd) noexcept
+{
+    fd_resource r{fd, fd_closer{}};
+    use(r.get());
+}
+
+void manual_unique_resource(int fd) noexcept
+{
+    use(fd);
+    close_fd(fd);
+}
+
+void guarded_unique_resource_throwing(int fd)
+{
+    fd_resource r{fd, fd_closer{}};
+    use_may_throw(r.get());
+}
+
+void manual_unique_resource_throwing(int fd)
+{
+    try {
+        use_may_throw(fd);
+    }
+    catch(...) {
+        close_fd(fd);
+        throw;
+    }
+    close_fd(fd);
+}
+
+void guarded_unique_resource_checked(int fd) noexcept
+{
+    auto r = scope::make_unique_resource_checked(fd, -1, fd_closer{});
+    use(r.get());
+}
+
+void manual_unique_resource_checked(int fd) noexcept
+{
+    use(fd);
+    if(fd != -1) {
+        close_fd(fd);
+    }
+}
+
+void guarded_unique_resource_move(int fd) noexcept
+{
+    fd_resource r{fd, fd_closer{}};
+    fd_resource r2{std::move(r)};
+    use(r2.get());
+}
+
+void manual_unique_resource_move(int fd) noexcept
+{
+    use(fd);
+    close_fd(fd);
+}
+
+void guarded_unique_resource_move_assign(fd_resource* to, fd_resource* from) noexcept
+{
+    *to = std::move(*from);
+}
+
+void manual_unique_resource_move_assign(manual_fd* to, manual_fd* from) noexcept
+{
+    if(to != from) {
+        if(to->owns) {
+            to->owns = false;
+            close_fd(to->fd);
+        }
+        to->fd = from->fd;
+        to->owns = from->owns;
+        from->owns = false;
+    }
+}
+
+void guarded_unique_resource_reset(fd_resource* r, int fd) noexcept
+{
+    r->reset(fd);
+}
+
+void manual_unique_resource_reset(manual_fd* r, int fd) noexcept
+{
+    if(r->owns) {
+        r->owns = false;
+        close_fd(r->fd);
+    }
+    r->fd = fd;
+    r->owns = true;
+}
+
+void guarded_unique_resource_release(fd_resource* r) noexcept
+{
+    r->release();
+}
+
+void manual_unique_resource_release(manual_fd* r) noexcept
+{
+    r->owns = false;
+}
+
+} // extern "C"
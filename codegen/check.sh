@@ -0,0 +1,53 @@
+#!/bin/sh
+# Compiles cases.cpp with each compiler at each optimization level, and
+# fails if a guarded function has more instructions than its hand-written
+# equivalent, beyond the allowance of its case. The disassembly of both is
+# printed for every case which fails.
+#
+# check.sh <out dir> <std> "<compilers>" "<levels>" <compiler flags>...
+# Compilers which are not installed are skipped.
+
+set -u
+
+here=$(dirname "$0")
+out=$1
+std=$2
+compilers=$3
+levels=$4
+shift 4
+
+mkdir -p "$out"
+status=0
+checked=0
+for cxx in $compilers; do
+    if ! command -v "$cxx" > /dev/null 2>&1; then
+        echo "codegen: $cxx not found, skipped"
+        continue
+    fi
+    for level in $levels; do
+        base="$out/$(basename "$cxx")$level"
+        # One section per function: no alignment padding is counted.
+        if ! "$cxx" -std="$std" "$level" -ffunction-sections "$@" -c "$here/cases.cpp" -o "$base.o"; then
+            status=1
+            continue
+        fi
+        objdump -d --no-show-raw-insn "$base.o" > "$base.dis"
+        if ! awk -v allowance="$here/allowance.txt" -v tag="$(basename "$cxx") $level" -f "$here/count.awk" "$base.dis" > "$base.txt"; then
+            status=1
+            cat "$base.txt"
+            for c in $(awk '$NF == "FAIL" { print $3 }' "$base.txt"); do
+                echo
+                awk -v c="$c" '/^[0-9a-f]+ </ { n = $2; gsub(/[<>:]/, "", n); sub(/\.cold$/, "", n); show = (n == "guarded_" c || n == "manual_" c) } /^Disassembly/ { show = 0 } show' "$base.dis"
+            done
+        else
+            cat "$base.txt"
+        fi
+        checked=$((checked + 1))
+    done
+done
+
+if [ "$checked" -eq 0 ]; then
+    echo "codegen: no compiler found"
+    exit 1
+fi
+exit $status
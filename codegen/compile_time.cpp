@@ -0,0 +1,89 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// COMPILE_COUNT instantiations of each guard, each with an exit function or
+// deleter type of its own, for compile_time.sh to time the front end on.
+#include "scope/scope.hpp"
+
+#include <utility>
+
+#if !defined(COMPILE_COUNT)
+#   define COMPILE_COUNT 1000
+#endif
+
+extern "C" {
+
+void close_fd(int fd) noexcept;
+void use_may_throw(int fd);
+
+} // extern "C"
+
+namespace {
+
+template <int I>
+struct closer
+{
+    void operator()(int fd) const noexcept { close_fd(fd + I); }
+};
+
+template <int I>
+void instance(int fd)
+{
+    auto g = scope::make_scope_exit([fd]{ close_fd(fd + I); });
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+    auto f = scope::make_scope_fail([fd]{ close_fd(fd - I); });
+    auto s = scope::make_scope_success([fd]{ close_fd(fd * I); });
+#endif
+    scope::unique_resource<int, closer<I>> r{fd, closer<I>{}};
+    auto r2 = std::move(r);
+    r2.reset(fd + 1);
+    r = std::move(r2);
+    auto c = scope::make_unique_resource_checked(fd, -1, closer<I>{});
+    use_may_throw(r.get() + c.get());
+}
+
+// Splits [First, Last) in halves, so that the depth of the recursion is
+// the logarithm of the count.
+template <int First, int Last, bool = (Last - First > 1)>
+struct instantiate
+{
+    static void run(int fd)
+    {
+        instantiate<First, (First + Last) / 2>::run(fd);
+        instantiate<(First + Last) / 2, Last>::run(fd);
+    }
+};
+
+template <int First, int Last>
+struct instantiate<First, Last, false>
+{
+    static void run(int fd)
+    {
+        instance<First>(fd);
+    }
+};
+
+} // namespace
+
+extern "C" void run_all(int fd)
+{
+    instantiate<0, COMPILE_COUNT>::run(fd);
+}
@@ -0,0 +1,72 @@
+#!/bin/sh
+# Times the front end (-fsyntax-only) of each compiler on a translation
+# unit which only includes scope.hpp, and on compile_time.cpp, with <count>
+# instantiations of each guard, for each configuration below. Prints the
+# fastest of <repetitions> runs, in milliseconds.
+#
+# compile_time.sh <out dir> "<compilers>" <count> <repetitions> <compiler flags>...
+# Compilers which are not installed are skipped.
+
+set -u
+
+here=$(dirname "$0")
+out=$1
+compilers=$2
+count=$3
+repetitions=$4
+shift 4
+
+# <name>:<flags>, the flags separated by commas. "-include functional"
+# stands for the <functional> which scope.hpp used to include.
+configs="c++20:-std=c++20
+c++20-enable_if:-std=c++20,-DSCOPE_NO_CONCEPTS
+c++20-enable_if+functional:-std=c++20,-DSCOPE_NO_CONCEPTS,-include,functional
+c++17:-std=c++17
+c++17+functional:-std=c++17,-include,functional
+c++11:-std=c++11"
+
+now()
+{
+    date +%s%N
+}
+
+# The fastest of the runs of a command, in milliseconds.
+fastest()
+{
+    best=
+    i=0
+    while [ $i -lt "$repetitions" ]; do
+        start=$(now)
+        "$@" || return 1
+        end=$(now)
+        ms=$(( (end - start) / 1000000 ))
+        if [ -z "$best" ] || [ $ms -lt $best ]; then
+            best=$ms
+        fi
+        i=$((i + 1))
+    done
+    echo $best
+}
+
+mkdir -p "$out"
+echo '#include "scope/scope.hpp"' > "$out/include_only.cpp"
+status=0
+printf "%-10s %-28s %10s %14s\n" "" "config" "header" "$count x guards"
+for cxx in $compilers; do
+    if ! command -v "$cxx" > /dev/null 2>&1; then
+        echo "compile_time: $cxx not found, skipped"
+        continue
+    fi
+    for c in $configs; do
+        name=${c%%:*}
+        flags=$(echo "${c#*:}" | tr , ' ')
+        # shellcheck disable=SC2086
+        header=$(fastest "$cxx" $flags "$@" -fsyntax-only "$out/include_only.cpp") &&
+        guards=$(fastest "$cxx" $flags "$@" -fsyntax-only -DCOMPILE_COUNT="$count" "$here/compile_time.cpp") || {
+            status=1
+            continue
+        }
+        printf "%-10s %-28s %10s %14s\n" "$(basename "$cxx")" "$name" "$header" "$guards"
+    done
+done
+exit $status
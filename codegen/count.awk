@@ -0,0 +1,45 @@
+# Counts the instructions of each function in `objdump -d` output, and
+# compares guarded_<case> with manual_<case>. The hot part of a function is
+# compared; the part the compiler moved out of line, <name>.cold, holding
+# the unwinding path, is only shown. A case may have up to the number of
+# extra instructions given for it in the allowance file, 0 if none.
+#
+# awk -v allowance=<file> -v tag=<compiler and level> -f count.awk <disassembly>
+
+/^[0-9a-f]+ <[^>]+>:$/ {
+    name = $2
+    gsub(/[<>:]/, "", name)
+    if (name ~ /^guarded_/ && name !~ /\.cold$/) {
+        cases[++ncases] = substr(name, 9)
+    }
+    next
+}
+
+/^ *[0-9a-f]+:\t/ && name != "" {
+    count[name]++
+}
+
+END {
+    while ((getline line < allowance) > 0) {
+        if (line ~ /^#/ || line ~ /^[ \t]*$/) {
+            continue
+        }
+        split(line, f, " ")
+        extra[f[1]] = f[2]
+    }
+
+    failed = 0
+    printf "%-14s %-36s %8s %8s %6s %12s\n", tag, "case", "guarded", "manual", "extra", "cold g/m"
+    for (i = 1; i <= ncases; i++) {
+        c = cases[i]
+        g = count["guarded_" c] + 0
+        m = count["manual_" c] + 0
+        limit = m + extra[c]
+        result = g > limit ? "FAIL" : "ok"
+        if (g > limit) {
+            failed = 1
+        }
+        printf "%-14s %-36s %8d %8d %+6d %5d/%-6d %s\n", tag, c, g, m, g - m, count["guarded_" c ".cold"], count["manual_" c ".cold"], result
+    }
+    exit failed
+}
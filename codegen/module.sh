@@ -0,0 +1,99 @@
+#!/bin/sh
+# Builds the module scope (include/scope/scope.cppm) with each compiler,
+# compiles the given tests once including scope.hpp and once importing the
+# module, runs the tests built on the module, and prints the build times,
+# in milliseconds, with those of a translation unit which only includes
+# scope.hpp or imports the module and creates a scope_exit.
+#
+# module.sh <out dir> "<compilers>" "<tests>" <compiler flags>...
+# Compilers which are not installed are skipped. The tests are names of
+# test/*.cpp which only use the names the module exports.
+
+set -u
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(dirname "$here")
+out=$1
+compilers=$2
+tests=$3
+shift 3
+
+now()
+{
+    date +%s%N
+}
+
+ms_since()
+{
+    echo $(( ($(now) - $1) / 1000000 ))
+}
+
+mkdir -p "$out"
+out=$(cd "$out" && pwd)
+use='int main() { int x = 0; { auto g = scope::make_scope_exit([&x]{ ++x; }); } return x - 1; }'
+printf '#include "scope/scope.hpp"\n%s\n' "$use" > "$out/use_header.cpp"
+printf 'import scope;\n%s\n' "$use" > "$out/use_module.cpp"
+status=0
+printf "%-10s %10s %12s %12s %14s %14s\n" "" "module" "use/header" "use/module" "tests/header" "tests/module"
+for cxx in $compilers; do
+    if ! command -v "$cxx" > /dev/null 2>&1; then
+        echo "module: $cxx not found, skipped"
+        continue
+    fi
+    name=$(basename "$cxx")
+    dir=$out/$name
+    rm -rf "$dir"
+    mkdir -p "$dir/header" "$dir/module"
+    case $name in
+    clang*)
+        # Clang precompiles the interface, then compiles it as any source.
+        build_module() {
+            "$cxx" -std=c++20 "$@" -x c++-module --precompile "$root/include/scope/scope.cppm" -o "$dir/scope.pcm" &&
+            "$cxx" -std=c++20 "$@" -c "$dir/scope.pcm" -o "$dir/scope.o"
+        }
+        import_flags="-fmodule-file=scope=$dir/scope.pcm"
+        ;;
+    *)
+        # GCC writes the compiled interface to gcm.cache in the working
+        # directory.
+        build_module() {
+            (cd "$dir" && "$cxx" -std=c++20 -fmodules-ts "$@" -x c++ -c "$root/include/scope/scope.cppm" -o "$dir/scope.o")
+        }
+        import_flags="-fmodules-ts"
+        ;;
+    esac
+
+    start=$(now)
+    build_module "$@" || { status=1; continue; }
+    module_ms=$(ms_since "$start")
+
+    start=$(now)
+    "$cxx" -std=c++20 "$@" -c "$out/use_header.cpp" -o "$dir/use_header.o" || { status=1; continue; }
+    use_header_ms=$(ms_since "$start")
+    start=$(now)
+    # shellcheck disable=SC2086
+    (cd "$dir" && "$cxx" -std=c++20 $import_flags "$@" -c "$out/use_module.cpp" -o "$dir/use_module.o") || { status=1; continue; }
+    use_module_ms=$(ms_since "$start")
+
+    header_ms=0
+    imported_ms=0
+    for t in $tests; do
+        start=$(now)
+        "$cxx" -std=c++20 "$@" -c "$root/test/$t.cpp" -o "$dir/header/$t.o" || { status=1; continue 2; }
+        header_ms=$((header_ms + $(ms_since "$start")))
+        start=$(now)
+        # shellcheck disable=SC2086
+        (cd "$dir" && "$cxx" -std=c++20 $import_flags "$@" -include "$root/test/import_scope.hpp" \
+            -c "$root/test/$t.cpp" -o "$dir/module/$t.o") || { status=1; continue 2; }
+        imported_ms=$((imported_ms + $(ms_since "$start")))
+    done
+
+    for f in main helper; do
+        "$cxx" -std=c++20 "$@" -c "$root/test/$f.cpp" -o "$dir/$f.o" || { status=1; continue 2; }
+    done
+    "$cxx" "$dir/module/"*.o "$dir/main.o" "$dir/helper.o" "$dir/scope.o" -o "$dir/test_module" &&
+    "$dir/test_module" || { status=1; continue; }
+
+    printf "%-10s %10s %12s %12s %14s %14s\n" "$name" "$module_ms" "$use_header_ms" "$use_module_ms" "$header_ms" "$imported_ms"
+done
+exit $status
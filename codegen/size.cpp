@@ -0,0 +1,95 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// SIZE_COUNT instantiations of the guard of SIZE_CASE, each with an exit
+// function or deleter type of its own, in functions of their own. size.sh
+// compiles it for two counts and reports the growth per instantiation.
+#include "scope/scope.hpp"
+
+#include <utility>
+
+extern "C" {
+
+void close_fd(int fd) noexcept;
+void use_may_throw(int fd);
+
+} // extern "C"
+
+namespace {
+
+template <int I>
+struct closer
+{
+    void operator()(int fd) const noexcept { close_fd(fd + I); }
+};
+
+template <int I>
+__attribute__((noinline)) void instance(int fd)
+{
+#if SIZE_CASE == 0 // manual
+    try {
+        use_may_throw(fd);
+    }
+    catch(...) {
+        close_fd(fd + I);
+        throw;
+    }
+    close_fd(fd + I);
+#elif SIZE_CASE == 1
+    auto g = scope::make_scope_exit([fd]{ close_fd(fd + I); });
+    use_may_throw(fd);
+#elif SIZE_CASE == 2
+    auto g = scope::make_scope_fail([fd]{ close_fd(fd + I); });
+    use_may_throw(fd);
+#elif SIZE_CASE == 3
+    scope::unique_resource<int, closer<I>> r{fd, closer<I>{}};
+    use_may_throw(r.get());
+#elif SIZE_CASE == 4
+    scope::unique_resource<int, closer<I>> r{fd, closer<I>{}};
+    auto r2 = std::move(r);
+    r2.reset(fd + 1);
+    r = std::move(r2);
+    use_may_throw(r.get());
+#endif
+}
+
+template <int N>
+struct instantiate
+{
+    static void run(int fd)
+    {
+        instance<N>(fd);
+        instantiate<N - 1>::run(fd);
+    }
+};
+
+template <>
+struct instantiate<0>
+{
+    static void run(int) {}
+};
+
+} // namespace
+
+extern "C" void run_all(int fd)
+{
+    instantiate<SIZE_COUNT>::run(fd);
+}
@@ -0,0 +1,60 @@
+#!/bin/sh
+# Compiles size.cpp with each compiler at each optimization level, with
+# 32 and 160 instantiations of each case, and prints the growth of .text,
+# and of the unwind tables (.eh_frame and .gcc_except_table), per
+# instantiation.
+#
+# size.sh <out dir> <std> "<compilers>" "<levels>" <compiler flags>...
+# Compilers which are not installed are skipped.
+
+set -u
+
+here=$(dirname "$0")
+out=$1
+std=$2
+compilers=$3
+levels=$4
+shift 4
+
+low=32
+high=160
+cases="0:manual 1:scope_exit 2:scope_fail 3:unique_resource 4:unique_resource_moved"
+
+# The sizes of the .text sections and of the unwind tables of an object.
+sizes()
+{
+    size -A "$1" | awk '
+        $1 ~ /^\.text/ { text += $2 }
+        $1 ~ /^\.eh_frame/ || $1 ~ /^\.gcc_except_table/ { eh += $2 }
+        END { print text + 0, eh + 0 }'
+}
+
+mkdir -p "$out"
+status=0
+printf "%-14s %-24s %12s %12s\n" "" "case" "text/inst" "unwind/inst"
+for cxx in $compilers; do
+    if ! command -v "$cxx" > /dev/null 2>&1; then
+        echo "size: $cxx not found, skipped"
+        continue
+    fi
+    for level in $levels; do
+        for c in $cases; do
+            n=${c%%:*}
+            name=${c#*:}
+            if [ "$n" -eq 2 ] && [ "$std" = c++11 -o "$std" = c++14 ]; then
+                continue
+            fi
+            for count in $low $high; do
+                if ! "$cxx" -std="$std" "$level" -DSIZE_CASE="$n" -DSIZE_COUNT="$count" "$@" \
+                        -c "$here/size.cpp" -o "$out/size$n-$count.o"; then
+                    status=1
+                    continue 3
+                fi
+            done
+            printf "%-14s %-24s %s %s\n" "$(basename "$cxx") $level" "$name" \
+                "$(sizes "$out/size$n-$low.o")" "$(sizes "$out/size$n-$high.o")" |
+                awk -v d=$((high - low)) '{ printf "%-14s %-24s %12.1f %12.1f\n", $1 " " $2, $3, ($6 - $4) / d, ($7 - $5) / d }'
+        done
+    done
+done
+exit $status
@@ -0,0 +1,401 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_SCOPE_ASYNC_SCOPE_HPP_
+#define NAKATT_SCOPE_ASYNC_SCOPE_HPP_
+
+#include "scope.hpp"
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#   if __has_include(<coroutine>)
+#       define SCOPE_USE_COROUTINE
+#   endif
+#endif
+
+#if defined(SCOPE_USE_COROUTINE)
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace scope {
+
+// The size of the buffer which holds the frame of the coroutine running an
+// async guard, inside the awaitable.
+inline constexpr std::size_t default_async_frame_size = 256;
+
+// What an async guard does when the frame of its coroutine is larger than
+// the buffer in the awaitable.
+enum class async_frame_overflow
+{
+    fail, // co_await throws std::bad_alloc, or terminates without exceptions
+    heap, // the frame goes to the heap
+};
+
+namespace detail {
+
+template <typename A, typename = void>
+struct awaiter_of
+{
+    using type = A;
+};
+
+template <typename A>
+struct awaiter_of<A, std::void_t<decltype(std::declval<A>().operator co_await())>>
+{
+    using type = decltype(std::declval<A>().operator co_await());
+};
+
+// The type of co_await a, for an awaitable with a member operator co_await()
+// or none.
+template <typename A>
+using await_result_t = decltype(std::declval<typename awaiter_of<A>::type&>().await_resume());
+
+// Each frame is preceded by a header which tells whether it is on the heap.
+struct frame_header
+{
+    alignas(std::max_align_t) bool heap;
+};
+
+inline void deallocate_frame(void* frame) noexcept
+{
+    frame_header* h = static_cast<frame_header*>(frame) - 1;
+    if(h->heap) {
+        ::operator delete(h);
+    }
+}
+
+template <std::size_t Size, async_frame_overflow Overflow>
+class frame_buffer
+{
+public:
+    void* allocate(std::size_t n)
+    {
+        const bool heap = sizeof(frame_header) + n > Size;
+        if(heap && Overflow == async_frame_overflow::fail) {
+#if defined(SCOPE_NO_EXCEPTIONS)
+            std::terminate();
+#else
+            throw std::bad_alloc{};
+#endif
+        }
+        frame_header* h = heap ? static_cast<frame_header*>(::operator new(sizeof(frame_header) + n))
+                               : reinterpret_cast<frame_header*>(buffer_);
+        h->heap = heap;
+        return h + 1;
+    }
+
+private:
+    alignas(std::max_align_t) unsigned char buffer_[Size];
+};
+
+// The coroutine which runs the body and the cleanup of an async guard. It
+// starts when awaited, and resumes the awaiting coroutine when it is done.
+class guarded_task
+{
+public:
+    struct promise_type
+    {
+        std::coroutine_handle<> continuation;
+
+        template <std::size_t Size, async_frame_overflow Overflow, typename... Args>
+        static void* operator new(std::size_t n, frame_buffer<Size, Overflow>& buffer, Args&...)
+        {
+            return buffer.allocate(n);
+        }
+
+        static void operator delete(void* p, std::size_t) noexcept
+        {
+            deallocate_frame(p);
+        }
+
+        guarded_task get_return_object() noexcept
+        {
+            return guarded_task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct final_awaiter
+        {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+            {
+                return h.promise().continuation;
+            }
+            void await_resume() noexcept {}
+        };
+
+        final_awaiter final_suspend() noexcept { return {}; }
+
+        void return_void() noexcept {}
+
+        // The body and the cleanup catch everything.
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+struct guarded_result
+{
+    std::exception_ptr error;
+    std::optional<T> value;
+
+    static_assert(!std::is_rvalue_reference<T>::value,
+        "the body of an async guard must not be awaited as an rvalue reference");
+
+    T get() { return std::move(*value); }
+};
+
+template <typename T>
+struct guarded_result<T&>
+{
+    std::exception_ptr error;
+    std::optional<std::reference_wrapper<T>> value;
+
+    T& get() { return value->get(); }
+};
+
+template <>
+struct guarded_result<void>
+{
+    std::exception_ptr error;
+
+    void get() {}
+};
+
+// GCC pairs the operator new of the promise, which takes the frame buffer,
+// with a placement operator delete and warns about the plain one, which is
+// the one used for coroutine frames.
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Awaits the body, then the cleanup if the guard calls for it. The first
+// exception, of the body or else of the cleanup, is kept for the awaiter.
+template <std::size_t Size, async_frame_overflow Overflow, typename Guard, typename Body, typename T>
+guarded_task run_guarded(frame_buffer<Size, Overflow>&, Guard& guard, Body& body, guarded_result<T>& result)
+{
+    bool failed = false;
+    SCOPE_TRY {
+        if constexpr(std::is_void<T>::value) {
+            co_await guard.start(body);
+        }
+        else {
+            result.value.emplace(co_await guard.start(body));
+        }
+    }
+    SCOPE_CATCH_ALL {
+        result.error = std::current_exception();
+        failed = true;
+    }
+    if(guard.call(failed)) {
+        SCOPE_TRY {
+            co_await guard.cleanup();
+        }
+        SCOPE_CATCH_ALL {
+            if(!result.error) {
+                result.error = std::current_exception();
+            }
+        }
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic pop
+#endif
+
+// The awaitable returned by the async guards. It lives in the frame of the
+// awaiting coroutine, and so does the frame of run_guarded.
+template <typename Guard, typename Body, std::size_t FrameSize, async_frame_overflow Overflow>
+class guarded_awaitable
+{
+    using result_type = await_result_t<decltype(std::declval<Guard&>().start(std::declval<Body&>()))>;
+
+public:
+    guarded_awaitable(Guard guard, Body body)
+        : guard_(std::move(guard))
+        , body_(std::move(body))
+    {}
+
+    guarded_awaitable(const guarded_awaitable&) = delete;
+    guarded_awaitable& operator=(const guarded_awaitable&) = delete;
+
+    ~guarded_awaitable()
+    {
+        if(task_.handle) {
+            task_.handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)
+    {
+        task_ = run_guarded(buffer_, guard_, body_, result_);
+        task_.handle.promise().continuation = awaiting;
+        return task_.handle;
+    }
+
+    result_type await_resume()
+    {
+        task_.handle.destroy();
+        task_.handle = nullptr;
+        if(result_.error) {
+            std::rethrow_exception(result_.error);
+        }
+        return result_.get();
+    }
+
+private:
+    Guard guard_;
+    Body body_;
+    guarded_result<result_type> result_;
+    guarded_task task_{};
+    frame_buffer<FrameSize, Overflow> buffer_;
+};
+
+// The cleanup of an async scope guard: EF returns an awaitable, awaited when
+// Strategy calls for it.
+template <typename Strategy, typename EF>
+class async_guard
+{
+public:
+    explicit async_guard(EF ef) : ef_(std::move(ef)) {}
+
+    template <typename Body>
+    decltype(auto) start(Body& body) { return body(); }
+
+    bool call(bool failed) const noexcept { return Strategy::call(failed); }
+
+    decltype(auto) cleanup() { return ef_(); }
+
+private:
+    EF ef_;
+};
+
+struct async_strategy_exit
+{
+    static bool call(bool) noexcept { return true; }
+};
+
+struct async_strategy_fail
+{
+    static bool call(bool failed) noexcept { return failed; }
+};
+
+struct async_strategy_success
+{
+    static bool call(bool failed) noexcept { return !failed; }
+};
+
+} // namespace detail
+
+// co_await async_scope_exit(body, ef) awaits body(), then ef(), on every
+// exit path of body, and returns the result of body() or rethrows its
+// exception. body() and ef() return awaitables. async_scope_fail awaits ef()
+// only if body() threw, async_scope_success only if it did not.
+//
+// The guard allocates nothing: its coroutine frame is stored in a buffer of
+// FrameSize bytes in the awaitable. A larger frame fails, unless Overflow
+// allows the heap.
+template <std::size_t FrameSize = default_async_frame_size, async_frame_overflow Overflow = async_frame_overflow::fail, typename Body, typename EF>
+detail::guarded_awaitable<detail::async_guard<detail::async_strategy_exit, std::decay_t<EF>>, std::decay_t<Body>, FrameSize, Overflow>
+async_scope_exit(Body&& body, EF&& ef)
+{
+    return {detail::async_guard<detail::async_strategy_exit, std::decay_t<EF>>{std::forward<EF>(ef)}, std::forward<Body>(body)};
+}
+
+template <std::size_t FrameSize = default_async_frame_size, async_frame_overflow Overflow = async_frame_overflow::fail, typename Body, typename EF>
+detail::guarded_awaitable<detail::async_guard<detail::async_strategy_fail, std::decay_t<EF>>, std::decay_t<Body>, FrameSize, Overflow>
+async_scope_fail(Body&& body, EF&& ef)
+{
+    return {detail::async_guard<detail::async_strategy_fail, std::decay_t<EF>>{std::forward<EF>(ef)}, std::forward<Body>(body)};
+}
+
+template <std::size_t FrameSize = default_async_frame_size, async_frame_overflow Overflow = async_frame_overflow::fail, typename Body, typename EF>
+detail::guarded_awaitable<detail::async_guard<detail::async_strategy_success, std::decay_t<EF>>, std::decay_t<Body>, FrameSize, Overflow>
+async_scope_success(Body&& body, EF&& ef)
+{
+    return {detail::async_guard<detail::async_strategy_success, std::decay_t<EF>>{std::forward<EF>(ef)}, std::forward<Body>(body)};
+}
+
+// A resource whose deleter returns an awaitable. It is used through
+// with_async_resource(), which awaits the deleter on every exit path unless
+// the body released the resource.
+template <typename R, typename D>
+class async_unique_resource
+{
+public:
+    async_unique_resource(R r, D d)
+        : resource_(std::move(r))
+        , deleter_(std::move(d))
+    {}
+
+    const R& get() const noexcept { return resource_; }
+    const D& get_deleter() const noexcept { return deleter_; }
+
+    void release() noexcept { execute_on_reset_ = false; }
+
+private:
+    template <typename, typename, std::size_t, async_frame_overflow>
+    friend class detail::guarded_awaitable;
+    template <std::size_t Size, async_frame_overflow Overflow, typename Guard, typename Body, typename T>
+    friend detail::guarded_task detail::run_guarded(detail::frame_buffer<Size, Overflow>&, Guard&, Body&, detail::guarded_result<T>&);
+
+    template <typename Body>
+    decltype(auto) start(Body& body) { return body(*this); }
+
+    bool call(bool) const noexcept { return execute_on_reset_; }
+
+    decltype(auto) cleanup()
+    {
+        execute_on_reset_ = false;
+        return deleter_(resource_);
+    }
+
+    R resource_;
+    D deleter_;
+    bool execute_on_reset_{true};
+};
+
+// co_await with_async_resource(r, d, body) awaits body(resource), where
+// resource is an async_unique_resource<R, D>&, then d(r).
+template <std::size_t FrameSize = default_async_frame_size, async_frame_overflow Overflow = async_frame_overflow::fail, typename R, typename D, typename Body>
+detail::guarded_awaitable<async_unique_resource<std::decay_t<R>, std::decay_t<D>>, std::decay_t<Body>, FrameSize, Overflow>
+with_async_resource(R&& r, D&& d, Body&& body)
+{
+    return {async_unique_resource<std::decay_t<R>, std::decay_t<D>>{std::forward<R>(r), std::forward<D>(d)}, std::forward<Body>(body)};
+}
+
+} // namespace scope
+
+#endif // defined(SCOPE_USE_COROUTINE)
+
+#endif // NAKATT_SCOPE_ASYNC_SCOPE_HPP_
@@ -0,0 +1,356 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_SCOPE_EPOCH_HPP_
+#define NAKATT_SCOPE_EPOCH_HPP_
+
+#include "scope.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scope {
+
+class epoch_domain;
+
+namespace detail {
+
+// The state of one thread in an epoch_domain. Records are never freed
+// before the domain: a thread which exits leaves its record, with any
+// retired functions not called yet, to the next thread.
+struct epoch_record
+{
+    static constexpr std::size_t buckets = 3;
+
+    // The global epoch seen by the thread in a critical section, 0 outside.
+    std::atomic<std::uint64_t> epoch{0};
+    std::atomic<bool> in_use{true};
+    epoch_record* next{nullptr};
+    unsigned nest{0};
+
+    // Functions retired in epoch bucket_epoch[e % 3] are kept in bucket e % 3.
+    std::uint64_t bucket_epoch[buckets] = {};
+    callback_stack<16> bucket[buckets];
+
+    // Calls the functions retired at least two epochs before global.
+    void reclaim(std::uint64_t global)
+    {
+        for(std::size_t b = 0; b < buckets; ++b) {
+            if(bucket[b].size() > 0 && bucket_epoch[b] + 2 <= global) {
+                bucket[b].run([](int){ return true; });
+            }
+        }
+    }
+
+    std::size_t pending() const noexcept
+    {
+        return bucket[0].size() + bucket[1].size() + bucket[2].size();
+    }
+};
+
+// Registers the calling thread in each domain it uses, and gives its records
+// back when the thread exits.
+class epoch_thread
+{
+public:
+    struct entry
+    {
+        epoch_domain* domain;
+        epoch_record* record;
+    };
+
+    static epoch_thread& local()
+    {
+        static thread_local epoch_thread t;
+        return t;
+    }
+
+    epoch_thread() = default;
+    epoch_thread(const epoch_thread&) = delete;
+    epoch_thread& operator=(const epoch_thread&) = delete;
+
+    inline ~epoch_thread();
+
+    inline epoch_record* record(epoch_domain& domain);
+
+    // The record of the thread in domain, or nullptr if it has none yet.
+    epoch_record* find(const epoch_domain& domain) const noexcept
+    {
+        if(last.domain == &domain) {
+            return last.record;
+        }
+        for(auto& e : entries_) {
+            if(e.domain == &domain) {
+                return e.record;
+            }
+        }
+        return nullptr;
+    }
+
+    void forget(epoch_domain* domain) noexcept
+    {
+        for(std::size_t i = entries_.size(); i > 0; --i) {
+            if(entries_[i - 1].domain == domain) {
+                entries_.erase(entries_.begin() + static_cast<std::ptrdiff_t>(i - 1));
+            }
+        }
+        if(last.domain == domain) {
+            last = entry{nullptr, nullptr};
+        }
+    }
+
+    entry last{nullptr, nullptr};
+
+private:
+    std::vector<entry> entries_;
+};
+
+} // namespace detail
+
+// Epoch based reclamation. Readers of lock free data enter a critical
+// section with an epoch_guard; a function passed to retire() is called once
+// every critical section which may have seen the retired object has ended.
+//
+// The global epoch advances when every thread in a critical section has seen
+// it. A function retired in epoch e is called when the global epoch reaches
+// e + 2. Retired functions are kept per thread and reclaimed in batches by
+// the thread which retired them.
+//
+// A domain must outlive the threads, other than the one destroying it,
+// which use it.
+class epoch_domain
+{
+public:
+    // How many functions a thread retires before it tries to advance the
+    // epoch and reclaim.
+    static constexpr std::size_t batch = 64;
+
+    epoch_domain() = default;
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain& operator=(const epoch_domain&) = delete;
+
+    // Calls every retired function. No thread may be in a critical section.
+    ~epoch_domain()
+    {
+        detail::epoch_thread::local().forget(this);
+        for(detail::epoch_record* r = records_.load(std::memory_order_acquire); r;) {
+            detail::epoch_record* next = r->next;
+            r->reclaim(UINT64_MAX);
+            delete r;
+            r = next;
+        }
+    }
+
+    // Calls f after a grace period. f is called by this thread in a later
+    // call of retire() or synchronize(), or by a thread which takes over the
+    // record of this thread after it exits. f is left untouched if this
+    // throws.
+    template <typename F>
+    void retire(F&& f)
+    {
+        detail::epoch_record* r = detail::epoch_thread::local().record(*this);
+        // Pairs with the fence in epoch_guard: the caller's unlink of the
+        // retired object must not be reordered after the read of the epoch,
+        // or the object could be tagged with an epoch a reader has left
+        // already while that reader can still reach it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::uint64_t e = epoch_.load(std::memory_order_seq_cst);
+        const std::size_t b = e % detail::epoch_record::buckets;
+        if(r->bucket_epoch[b] != e) {
+            // Retired 3 epochs ago at least.
+            r->bucket[b].run([](int){ return true; });
+            r->bucket_epoch[b] = e;
+        }
+        r->bucket[b].template push<0>(std::forward<F>(f));
+        if(r->pending() >= batch) {
+            try_advance();
+            r->reclaim(epoch_.load(std::memory_order_acquire));
+        }
+    }
+
+    // Waits until every function retired by this thread, and by exited
+    // threads, has been called. Must not be called in a critical section.
+    void synchronize()
+    {
+        detail::epoch_record* self = detail::epoch_thread::local().record(*this);
+        const std::uint64_t target = epoch_.load(std::memory_order_acquire) + 2;
+        while(epoch_.load(std::memory_order_acquire) < target) {
+            if(!try_advance()) {
+                std::this_thread::yield();
+            }
+        }
+        const std::uint64_t global = epoch_.load(std::memory_order_acquire);
+        self->reclaim(global);
+        for(detail::epoch_record* r = records_.load(std::memory_order_acquire); r; r = r->next) {
+            bool expected = false;
+            if(r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                r->reclaim(global);
+                r->in_use.store(false, std::memory_order_release);
+            }
+        }
+    }
+
+    // Advances the global epoch if every thread in a critical section has
+    // seen it.
+    bool try_advance() noexcept
+    {
+        // Pairs with the fence in epoch_guard.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::uint64_t e = epoch_.load(std::memory_order_seq_cst);
+        for(detail::epoch_record* r = records_.load(std::memory_order_acquire); r; r = r->next) {
+            const std::uint64_t seen = r->epoch.load(std::memory_order_seq_cst);
+            if(seen != 0 && seen != e) {
+                return false;
+            }
+        }
+        return epoch_.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel);
+    }
+
+    std::uint64_t epoch() const noexcept { return epoch_.load(std::memory_order_acquire); }
+
+    // The number of functions retired by this thread and not called yet.
+    std::size_t pending() const noexcept
+    {
+        const detail::epoch_record* r = detail::epoch_thread::local().find(*this);
+        return r ? r->pending() : 0;
+    }
+
+private:
+    friend class detail::epoch_thread;
+    friend class epoch_guard;
+
+    // Takes over the record of an exited thread, or adds a new one.
+    detail::epoch_record* acquire()
+    {
+        for(detail::epoch_record* r = records_.load(std::memory_order_acquire); r; r = r->next) {
+            bool expected = false;
+            if(r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return r;
+            }
+        }
+        detail::epoch_record* r = new detail::epoch_record;
+        r->next = records_.load(std::memory_order_relaxed);
+        while(!records_.compare_exchange_weak(r->next, r, std::memory_order_acq_rel)) {}
+        return r;
+    }
+
+    void release(detail::epoch_record* r) noexcept
+    {
+        r->in_use.store(false, std::memory_order_release);
+    }
+
+    // Starts at 1: 0 in a record means outside of a critical section.
+    std::atomic<std::uint64_t> epoch_{1};
+    std::atomic<detail::epoch_record*> records_{nullptr};
+};
+
+namespace detail {
+
+inline epoch_thread::~epoch_thread()
+{
+    for(auto& e : entries_) {
+        e.domain->release(e.record);
+    }
+}
+
+inline epoch_record* epoch_thread::record(epoch_domain& domain)
+{
+    epoch_record* r = find(domain);
+    if(!r) {
+        r = domain.acquire();
+        entries_.push_back(entry{&domain, r});
+    }
+    last = entry{&domain, r};
+    return r;
+}
+
+} // namespace detail
+
+// The domain used by default.
+inline epoch_domain& default_epoch_domain()
+{
+    static epoch_domain d;
+    return d;
+}
+
+// A read side critical section: objects retired while it is alive are not
+// deleted before it ends. Critical sections may nest.
+class epoch_guard
+{
+public:
+    explicit epoch_guard(epoch_domain& domain = default_epoch_domain())
+        : record_{detail::epoch_thread::local().record(domain)}
+    {
+        if(record_->nest++ == 0) {
+            record_->epoch.store(domain.epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            // Publish the epoch before reading shared data.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    epoch_guard(const epoch_guard&) = delete;
+    epoch_guard& operator=(const epoch_guard&) = delete;
+
+    ~epoch_guard()
+    {
+        if(--record_->nest == 0) {
+            record_->epoch.store(0, std::memory_order_release);
+        }
+    }
+
+private:
+    detail::epoch_record* record_;
+};
+
+namespace detail {
+
+template <typename T>
+struct retired_resource
+{
+    T resource;
+    void operator()() { resource.reset(); }
+};
+
+} // namespace detail
+
+// Resets r after a grace period: the deleter of a unique_resource handed to
+// retire() runs once no reader can see the resource any more. r still owns
+// the resource if this throws.
+template <typename R, typename D, typename P>
+void retire(unique_resource<R, D, P>&& r, epoch_domain& domain = default_epoch_domain())
+{
+    detail::retired_resource<unique_resource<R, D, P>> retired{std::move(r)};
+    SCOPE_TRY {
+        domain.retire(std::move(retired));
+    }
+    SCOPE_CATCH_ALL {
+        r = std::move(retired.resource);
+        SCOPE_RETHROW;
+    }
+}
+
+} // namespace scope
+
+#endif // NAKATT_SCOPE_EPOCH_HPP_
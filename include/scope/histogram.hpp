@@ -0,0 +1,483 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_SCOPE_HISTOGRAM_HPP_
+#define NAKATT_SCOPE_HISTOGRAM_HPP_
+
+#include "scope.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace scope {
+
+class histogram;
+
+namespace detail {
+
+// The buckets of a log-linear histogram of 64 bit values. Values below
+// sub_buckets have a bucket each; every power of 2 above is split into
+// sub_buckets linear buckets, so a bucket is at most 1/sub_buckets of its
+// lower bound wide.
+struct log_linear
+{
+    static constexpr unsigned sub_bucket_bits = 4;
+    static constexpr std::size_t sub_buckets = std::size_t{1} << sub_bucket_bits;
+    static constexpr std::size_t buckets = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+    static unsigned log2(std::uint64_t v) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - static_cast<unsigned>(__builtin_clzll(v));
+#else
+        unsigned e = 0;
+        while(v >>= 1) {
+            ++e;
+        }
+        return e;
+#endif
+    }
+
+    static std::size_t index(std::uint64_t v) noexcept
+    {
+        if(v < sub_buckets) {
+            return static_cast<std::size_t>(v);
+        }
+        const unsigned e = log2(v);
+        return (e - sub_bucket_bits + 1) * sub_buckets + static_cast<std::size_t>((v >> (e - sub_bucket_bits)) & (sub_buckets - 1));
+    }
+
+    static std::uint64_t lower(std::size_t i) noexcept
+    {
+        if(i < sub_buckets) {
+            return i;
+        }
+        const unsigned e = static_cast<unsigned>(i / sub_buckets) + sub_bucket_bits - 1;
+        return (sub_buckets + i % sub_buckets) << (e - sub_bucket_bits);
+    }
+
+    static std::uint64_t upper(std::size_t i) noexcept
+    {
+        if(i < sub_buckets) {
+            return i;
+        }
+        const unsigned e = static_cast<unsigned>(i / sub_buckets) + sub_bucket_bits - 1;
+        return lower(i) + ((std::uint64_t{1} << (e - sub_bucket_bits)) - 1);
+    }
+};
+
+// Storage for a T which is constructed on first use and never destroyed, so
+// that it stays usable by threads and static objects which outlive the
+// static objects of its translation unit.
+template <typename T>
+class immortal
+{
+public:
+    immortal() noexcept
+        : p_{::new(static_cast<void*>(storage_)) T()}
+    {
+    }
+
+    T& get() const noexcept
+    {
+        return *p_;
+    }
+
+private:
+    alignas(T) unsigned char storage_[sizeof(T)];
+    T* const p_;
+};
+
+enum class shard_state : unsigned char
+{
+    free,       // left by an exited thread, to the next one
+    used,       // in the list of a thread
+    detached,   // its histogram is destroyed: freed by the thread on exit
+};
+
+// The part of a histogram written by one thread. Only the owner writes it,
+// without read-modify-write; a thread which exits leaves it to the next
+// thread which records into the same histogram, or frees it if the
+// histogram is already destroyed.
+struct histogram_shard
+{
+    explicit histogram_shard(const histogram* h) noexcept
+        : owner{h}
+    {
+        for(auto& n : counts) {
+            n.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void record(std::uint64_t v) noexcept
+    {
+        std::atomic<std::uint64_t>& n = counts[log_linear::index(v)];
+        n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        if(v > max.load(std::memory_order_relaxed)) {
+            max.store(v, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<std::uint64_t> counts[log_linear::buckets];
+    std::atomic<std::uint64_t> sum{0};
+    std::atomic<std::uint64_t> max{0};
+    std::atomic<shard_state> state{shard_state::used};
+    const histogram* const owner;
+    histogram_shard* next{nullptr};
+    histogram_shard* thread_next{nullptr};
+};
+
+// The shards owned by the calling thread, given back when it exits.
+class histogram_thread
+{
+public:
+    static histogram_shard*& head() noexcept
+    {
+        return state().head;
+    }
+
+    // Whether the thread may still take shards: not once it has exited.
+    static bool attach() noexcept
+    {
+        state_type& s = state();
+        if(!s.attached && !s.exited) {
+            static thread_local owner o;
+            (void)o;
+            s.attached = true;
+        }
+        return !s.exited;
+    }
+
+    // Drops the shards of h, destroyed by the calling thread, from its list.
+    static void forget(const histogram* h) noexcept
+    {
+        for(histogram_shard** p = &state().head; *p;) {
+            if((*p)->owner == h) {
+                (*p)->state.store(shard_state::free, std::memory_order_relaxed);
+                *p = (*p)->thread_next;
+            }
+            else {
+                p = &(*p)->thread_next;
+            }
+        }
+    }
+
+private:
+    // Trivially destructible, so that it stays usable by objects destroyed
+    // after owner.
+    struct state_type
+    {
+        histogram_shard* head;
+        bool attached;
+        bool exited;
+    };
+
+    struct owner
+    {
+        ~owner()
+        {
+            state_type& s = state();
+            for(histogram_shard* p = s.head; p;) {
+                histogram_shard* next = p->thread_next;
+                p->thread_next = nullptr;
+                if(p->state.exchange(shard_state::free, std::memory_order_acq_rel) == shard_state::detached) {
+                    delete p;
+                }
+                p = next;
+            }
+            s.head = nullptr;
+            s.exited = true;
+        }
+    };
+
+    static state_type& state() noexcept
+    {
+        static thread_local state_type s{nullptr, false, false};
+        return s;
+    }
+};
+
+} // namespace detail
+
+// A copy of the counts of a histogram, summed over the threads which
+// recorded into it.
+class histogram_snapshot
+{
+public:
+    static constexpr std::size_t buckets = detail::log_linear::buckets;
+
+    // The bucket of v, and the least and greatest values of bucket i.
+    static std::size_t   bucket_of(std::uint64_t v) noexcept { return detail::log_linear::index(v); }
+    static std::uint64_t bucket_lower(std::size_t i) noexcept { return detail::log_linear::lower(i); }
+    static std::uint64_t bucket_upper(std::size_t i) noexcept { return detail::log_linear::upper(i); }
+
+    histogram_snapshot() noexcept
+    {
+        clear();
+    }
+
+    void clear() noexcept
+    {
+        for(auto& n : counts_) {
+            n = 0;
+        }
+        count_ = sum_ = max_ = 0;
+    }
+
+    std::uint64_t bucket_count(std::size_t i) const noexcept { return counts_[i]; }
+    std::uint64_t count() const noexcept { return count_; }
+    std::uint64_t sum() const noexcept { return sum_; }
+    std::uint64_t max() const noexcept { return max_; }
+    double mean() const noexcept { return count_ ? double(sum_) / double(count_) : 0.0; }
+
+    // The greatest value of the bucket which holds the value of rank p
+    // (0 to 100) percent, but not more than max(). 0 if empty.
+    std::uint64_t percentile(double p) const noexcept
+    {
+        if(count_ == 0) {
+            return 0;
+        }
+        std::uint64_t rank = static_cast<std::uint64_t>(p / 100.0 * double(count_) + 0.5);
+        rank = rank < 1 ? 1 : (rank > count_ ? count_ : rank);
+        std::uint64_t seen = 0;
+        for(std::size_t i = 0; i < buckets; ++i) {
+            seen += counts_[i];
+            if(seen >= rank) {
+                const std::uint64_t v = bucket_upper(i);
+                return v < max_ ? v : max_;
+            }
+        }
+        return max_;
+    }
+
+    histogram_snapshot& operator+=(const histogram_snapshot& rhs) noexcept
+    {
+        for(std::size_t i = 0; i < buckets; ++i) {
+            counts_[i] += rhs.counts_[i];
+        }
+        count_ += rhs.count_;
+        sum_ += rhs.sum_;
+        max_ = max_ < rhs.max_ ? rhs.max_ : max_;
+        return *this;
+    }
+
+private:
+    friend class histogram;
+
+    std::uint64_t counts_[buckets];
+    std::uint64_t count_;
+    std::uint64_t sum_;
+    std::uint64_t max_;
+};
+
+// A log-linear histogram with one shard per recording thread: record() is
+// lock free and does not write shared cache lines. Shards are summed on
+// demand by snapshot(), which may run on any thread at any time.
+//
+// A thread may outlive a histogram it recorded into: the shards of threads
+// still running when it is destroyed are detached, and freed by the threads
+// as they exit. No thread may record into a histogram being destroyed.
+class histogram
+{
+public:
+    histogram() noexcept = default;
+    histogram(const histogram&) = delete;
+    histogram& operator=(const histogram&) = delete;
+
+    ~histogram()
+    {
+        detail::histogram_thread::forget(this);
+        for(detail::histogram_shard* s = shards_.load(std::memory_order_acquire); s;) {
+            detail::histogram_shard* next = s->next;
+            if(s->state.exchange(detail::shard_state::detached, std::memory_order_acq_rel) == detail::shard_state::free) {
+                delete s;
+            }
+            s = next;
+        }
+    }
+
+    // Records v on the calling thread. v is dropped if the shard of the
+    // thread can not be allocated, or once the thread has exited.
+    void record(std::uint64_t v) noexcept
+    {
+        if(detail::histogram_shard* s = shard()) {
+            s->record(v);
+        }
+    }
+
+    // Sums the counts of every thread, past and present, into out.
+    void snapshot(histogram_snapshot& out) const noexcept
+    {
+        out.clear();
+        for(const detail::histogram_shard* s = shards_.load(std::memory_order_acquire); s; s = s->next) {
+            for(std::size_t i = 0; i < histogram_snapshot::buckets; ++i) {
+                const std::uint64_t n = s->counts[i].load(std::memory_order_relaxed);
+                out.counts_[i] += n;
+                out.count_ += n;
+            }
+            out.sum_ += s->sum.load(std::memory_order_relaxed);
+            const std::uint64_t m = s->max.load(std::memory_order_relaxed);
+            out.max_ = out.max_ < m ? m : out.max_;
+        }
+    }
+
+    histogram_snapshot snapshot() const noexcept
+    {
+        histogram_snapshot out;
+        snapshot(out);
+        return out;
+    }
+
+private:
+    detail::histogram_shard* shard() noexcept
+    {
+        detail::histogram_shard*& head = detail::histogram_thread::head();
+        if(head && head->owner == this && head->state.load(std::memory_order_relaxed) == detail::shard_state::used) {
+            return head;
+        }
+        if(!detail::histogram_thread::attach()) {
+            return nullptr;
+        }
+        // Free the shards of destroyed histograms, one of which may have had
+        // the address of this one, and move the shard found to the front: a
+        // thread usually records into one histogram at a time.
+        for(detail::histogram_shard** p = &head; *p;) {
+            if((*p)->state.load(std::memory_order_acquire) == detail::shard_state::detached) {
+                detail::histogram_shard* s = *p;
+                *p = s->thread_next;
+                delete s;
+            }
+            else if((*p)->owner == this) {
+                detail::histogram_shard* s = *p;
+                *p = s->thread_next;
+                s->thread_next = head;
+                head = s;
+                return s;
+            }
+            else {
+                p = &(*p)->thread_next;
+            }
+        }
+        detail::histogram_shard* s = take_shard();
+        if(s) {
+            s->thread_next = head;
+            head = s;
+        }
+        return s;
+    }
+
+    detail::histogram_shard* take_shard() noexcept
+    {
+        for(detail::histogram_shard* s = shards_.load(std::memory_order_acquire); s; s = s->next) {
+            detail::shard_state expected = detail::shard_state::free;
+            if(s->state.compare_exchange_strong(expected, detail::shard_state::used, std::memory_order_acquire)) {
+                return s;
+            }
+        }
+        detail::histogram_shard* s = new(std::nothrow) detail::histogram_shard{this};
+        if(s) {
+            s->next = shards_.load(std::memory_order_relaxed);
+            while(!shards_.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed)) {
+            }
+        }
+        return s;
+    }
+
+    std::atomic<detail::histogram_shard*> shards_{nullptr};
+};
+
+// Clocks of hold_time and scope_timer: now() returns a count of ticks,
+// unit() their name.
+
+// Nanoseconds of std::chrono::steady_clock.
+struct steady_ticks
+{
+    static const char* unit() noexcept { return "ns"; }
+
+    static std::uint64_t now() noexcept
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+};
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+// Reference cycles of the time stamp counter. Cheaper than steady_ticks, but
+// not converted to time and not ordered with the surrounding instructions.
+struct tsc_ticks
+{
+    static const char* unit() noexcept { return "cycles"; }
+
+    static std::uint64_t now() noexcept
+    {
+        return __builtin_ia32_rdtsc();
+    }
+};
+#endif
+
+// The key of the hold time histogram of unique_resource<R, D, hold_time<>>.
+template <typename R, typename D>
+struct resource_key {};
+
+// The hold time histogram of Key, in ticks of Clock. It is never destroyed:
+// resources may be released by threads which outlive static destruction, or
+// by static objects destroyed after it would have been.
+template <typename Key, typename Clock = steady_ticks>
+histogram& hold_time_histogram()
+{
+    static detail::immortal<histogram> h;
+    return h.get();
+}
+
+// A unique_resource policy which records how long each resource is owned
+// into hold_time_histogram<Tag, Clock>(), or hold_time_histogram<
+// resource_key<R, D>, Clock>() if Tag is void. The time is taken when the
+// resource is acquired and recorded when the deleter is called; a released
+// resource is not recorded.
+template <typename Tag = void, typename Clock = steady_ticks>
+class hold_time
+{
+    template <typename R, typename D>
+    using key_t = detail::conditional_t<std::is_void<Tag>::value, resource_key<R, D>, Tag>;
+
+public:
+    template <typename R, typename D>
+    void on_acquire(const R&, const D&) noexcept
+    {
+        acquired_at_ = Clock::now();
+    }
+
+    template <typename R, typename D>
+    void on_reset(const R&, const D&) noexcept
+    {
+        hold_time_histogram<key_t<R, D>, Clock>().record(Clock::now() - acquired_at_);
+    }
+
+private:
+    std::uint64_t acquired_at_{0};
+};
+
+} // namespace scope
+
+#endif // NAKATT_SCOPE_HISTOGRAM_HPP_
@@ -0,0 +1,319 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_SCOPE_INSTRUMENTATION_HPP_
+#define NAKATT_SCOPE_INSTRUMENTATION_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace scope {
+
+// Defined in scope.hpp.
+enum class guard_kind;
+
+// The counters of the guards, which scope.hpp includes when
+// SCOPE_ENABLE_INSTRUMENTATION is defined. They are outside of the inline
+// namespaces of the guards: translation units built with other options
+// share them.
+namespace instrumentation_detail {
+
+// Activity of the guards of one kind created at one site.
+struct guard_stats
+{
+    const char* file;
+    unsigned line;
+    guard_kind kind;
+    std::uint64_t created;
+    std::uint64_t released;
+    std::uint64_t fired;
+    std::uint64_t fired_during_unwind;
+};
+
+enum guard_event
+{
+    event_created,
+    event_released,
+    event_fired,
+    event_fired_during_unwind,
+    guard_events
+};
+
+// The counters of one site, in a cache line of their own. Only the thread
+// which owns the record writes them; the key is written once, before file
+// is published.
+struct counter_slot
+{
+    std::atomic<const char*> file{nullptr};
+    unsigned line{0};
+    guard_kind kind{};
+    std::atomic<std::uint64_t> count[guard_events];
+    unsigned char pad[64 - sizeof(std::atomic<const char*>) - sizeof(unsigned) - sizeof(guard_kind) - guard_events * sizeof(std::atomic<std::uint64_t>)];
+
+    counter_slot() noexcept
+    {
+        for(auto& n : count) {
+            n.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void add(guard_event e) noexcept
+    {
+        // A single writer: no read-modify-write is needed.
+        count[e].store(count[e].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
+// The counters of one thread. Records are never freed: a thread which exits
+// leaves its record, and the counts in it, to the next thread.
+class counter_record
+{
+public:
+    static constexpr std::size_t capacity = 128;
+    static constexpr std::size_t line_size = 64;
+
+    // The record of the calling thread, nullptr once it has exited.
+    static counter_record* local() noexcept
+    {
+        thread_local_state& s = state();
+        if(!s.record && !s.exited) {
+            s.record = acquire();
+            static thread_local owner o;
+            (void)o;
+        }
+        return s.record;
+    }
+
+    static std::atomic<counter_record*>& head() noexcept
+    {
+        static std::atomic<counter_record*> h{nullptr};
+        return h;
+    }
+
+    counter_record* next() const noexcept { return next_; }
+
+    bool owns(const counter_slot* s) const noexcept
+    {
+        return s >= slots_ && s < slots_ + capacity + 1;
+    }
+
+    // The slot of the site, claimed on first use. Sites beyond capacity
+    // share the last slot, which has no file.
+    counter_slot* find(const char* file, unsigned line, guard_kind kind) noexcept
+    {
+        if(!file) {
+            return &slots_[capacity];
+        }
+        std::size_t h = (reinterpret_cast<std::uintptr_t>(file) >> 3) ^ (line * 0x9e3779b9u) ^ static_cast<std::size_t>(kind);
+        for(std::size_t n = 0; n < capacity; ++n, ++h) {
+            counter_slot& s = slots_[h % capacity];
+            const char* f = s.file.load(std::memory_order_relaxed);
+            if(f == file && s.line == line && s.kind == kind) {
+                return &s;
+            }
+            if(!f) {
+                s.line = line;
+                s.kind = kind;
+                s.file.store(file, std::memory_order_release);
+                return &s;
+            }
+        }
+        return &slots_[capacity];
+    }
+
+    template <typename F>
+    void for_each(F&& f) const
+    {
+        for(const counter_slot& s : slots_) {
+            if(&s == &slots_[capacity] || s.file.load(std::memory_order_acquire)) {
+                f(s);
+            }
+        }
+    }
+
+private:
+    struct thread_local_state
+    {
+        counter_record* record;
+        bool exited;
+    };
+
+    // Gives the record back when the thread exits. The state has a trivial
+    // destructor, so guards destroyed later on the thread still see it.
+    struct owner
+    {
+        ~owner()
+        {
+            thread_local_state& s = state();
+            if(s.record) {
+                s.record->in_use_.store(false, std::memory_order_release);
+            }
+            s.record = nullptr;
+            s.exited = true;
+        }
+    };
+
+    static thread_local_state& state() noexcept
+    {
+        static thread_local thread_local_state s{nullptr, false};
+        return s;
+    }
+
+    static counter_record* acquire() noexcept
+    {
+        std::atomic<counter_record*>& h = head();
+        for(counter_record* r = h.load(std::memory_order_acquire); r; r = r->next_) {
+            bool expected = false;
+            if(r->in_use_.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return r;
+            }
+        }
+        // Placed on a cache line boundary by hand: new does not honor the
+        // alignment of over aligned types before C++17.
+        void* p = ::operator new(sizeof(counter_record) + line_size, std::nothrow);
+        if(!p) {
+            return nullptr;
+        }
+        const std::uintptr_t a = (reinterpret_cast<std::uintptr_t>(p) + line_size) & ~std::uintptr_t(line_size - 1);
+        counter_record* r = ::new(reinterpret_cast<void*>(a)) counter_record{};
+        r->next_ = h.load(std::memory_order_relaxed);
+        while(!h.compare_exchange_weak(r->next_, r, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        return r;
+    }
+
+    counter_slot slots_[capacity + 1];
+    std::atomic<bool> in_use_{true};
+    counter_record* next_{nullptr};
+};
+
+// Counts the activity of one guard in the counters of the calling thread.
+// It keeps the slot of its site, which is looked up again only when the
+// guard is used on another thread. A site without a file is not counted.
+class guard_probe
+{
+public:
+    void created(const char* file, unsigned line, guard_kind kind) noexcept
+    {
+        slot_ = nullptr;
+        if(file) {
+            if(counter_record* r = counter_record::local()) {
+                slot_ = r->find(file, line, kind);
+                slot_->add(event_created);
+            }
+        }
+    }
+
+    void released() noexcept
+    {
+        count(event_released);
+    }
+
+    // The guard tells whether an exception is in flight: that depends on
+    // the options it is built with, the counters do not.
+    void fired(bool unwinding) noexcept
+    {
+        count(unwinding ? event_fired_during_unwind : event_fired);
+    }
+
+private:
+    void count(guard_event e) noexcept
+    {
+        if(!slot_) {
+            return;
+        }
+        counter_record* r = counter_record::local();
+        if(!r) {
+            return;
+        }
+        if(!r->owns(slot_)) {
+            slot_ = r->find(slot_->file.load(std::memory_order_relaxed), slot_->line, slot_->kind);
+        }
+        slot_->add(e);
+    }
+
+    counter_slot* slot_{nullptr};
+};
+
+// Sums the counters of every thread, past and present, per site into out.
+// out is cleared first; its storage is reused, so a stats thread which
+// keeps one vector does not allocate after the first call. Sites are
+// sorted by file, line and kind.
+inline void guard_stats_snapshot(std::vector<guard_stats>& out)
+{
+    out.clear();
+    for(counter_record* r = counter_record::head().load(std::memory_order_acquire); r; r = r->next()) {
+        r->for_each([&out](const counter_slot& s) {
+            guard_stats st{s.file.load(std::memory_order_acquire), s.line, s.kind, 0, 0, 0, 0};
+            st.created             = s.count[event_created].load(std::memory_order_relaxed);
+            st.released            = s.count[event_released].load(std::memory_order_relaxed);
+            st.fired               = s.count[event_fired].load(std::memory_order_relaxed);
+            st.fired_during_unwind = s.count[event_fired_during_unwind].load(std::memory_order_relaxed);
+            if(st.file || st.created || st.released || st.fired || st.fired_during_unwind) {
+                out.push_back(st);
+            }
+        });
+    }
+    // The same file may have a different name pointer in each translation
+    // unit: sites are compared by name.
+    const auto less = [](const guard_stats& a, const guard_stats& b) {
+        const int c = std::strcmp(a.file ? a.file : "", b.file ? b.file : "");
+        if(c != 0) {
+            return c < 0;
+        }
+        return a.line != b.line ? a.line < b.line : a.kind < b.kind;
+    };
+    std::sort(out.begin(), out.end(), less);
+    std::size_t n = 0;
+    for(std::size_t i = 0; i < out.size(); ++i) {
+        if(n > 0 && !less(out[n - 1], out[i]) && !less(out[i], out[n - 1])) {
+            out[n - 1].created             += out[i].created;
+            out[n - 1].released            += out[i].released;
+            out[n - 1].fired               += out[i].fired;
+            out[n - 1].fired_during_unwind += out[i].fired_during_unwind;
+        }
+        else {
+            out[n++] = out[i];
+        }
+    }
+    out.resize(n);
+}
+
+inline std::vector<guard_stats> guard_stats_snapshot()
+{
+    std::vector<guard_stats> out;
+    guard_stats_snapshot(out);
+    return out;
+}
+
+} // namespace instrumentation_detail
+
+using instrumentation_detail::guard_stats;
+using instrumentation_detail::guard_stats_snapshot;
+
+} // namespace scope
+
+#endif // NAKATT_SCOPE_INSTRUMENTATION_HPP_
@@ -0,0 +1,429 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_SCOPE_LIVE_REGISTRY_HPP_
+#define NAKATT_SCOPE_LIVE_REGISTRY_HPP_
+
+// The registry of live resources, which scope.hpp includes when
+// SCOPE_ENABLE_LIVE_REGISTRY is defined: unique_resource joins it when it
+// acquires a resource and leaves it when it releases or deletes it.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+#if defined(__linux__)
+#include <time.h>
+#else
+#include <chrono>
+#endif
+
+#if !defined(SCOPE_LIVE_REGISTRY_SHARD_SLOTS)
+#   define SCOPE_LIVE_REGISTRY_SHARD_SLOTS 1024
+#endif
+
+namespace scope {
+
+// The registry of live resources is outside of the inline namespaces of the
+// guards: translation units built with and without the instrumentation
+// share it.
+namespace live_detail {
+
+// The low two bits of live_slot::state are the phase of the slot; the
+// others count the uses of the slot, so that a reader can tell that it
+// was left and claimed again while it was read.
+constexpr std::uint64_t phase_free = 0;
+constexpr std::uint64_t phase_writing = 1;
+constexpr std::uint64_t phase_live = 2;
+constexpr std::uint64_t phase_mask = 3;
+
+// One live resource. Every field is written by the thread which claimed
+// the slot, between the writing and the live phase; the slot is left by
+// the thread which destroys the resource.
+struct live_slot
+{
+    std::atomic<std::uint64_t> state{0};
+    std::atomic<const char*> file{nullptr};
+    std::atomic<std::uint64_t> line{0};   // the line, and 1 << 32 if value is set
+    std::atomic<std::uint64_t> value{0};
+    std::atomic<std::uint64_t> acquired{0};
+};
+
+// A coarse clock is enough for the age of a resource, and much cheaper.
+inline std::uint64_t now() noexcept
+{
+#if defined(__linux__)
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + static_cast<std::uint64_t>(ts.tv_nsec);
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// An open addressing table of slots which one thread at a time claims
+// from. Only the free to live transition is made by the owner, and a slot
+// is left by a plain store, so neither needs an atomic read-modify-write.
+// Shards are never freed: a thread which exits, or fills its shard, leaves
+// it to the next thread, with the resources still live in it.
+class live_shard
+{
+public:
+    static constexpr std::size_t capacity = SCOPE_LIVE_REGISTRY_SHARD_SLOTS;
+    static constexpr std::size_t line_size = 64;
+
+    static std::atomic<live_shard*>& head() noexcept
+    {
+        static std::atomic<live_shard*> h{nullptr};
+        return h;
+    }
+
+    live_shard* next() const noexcept { return next_; }
+
+    // Claims a free slot in the shard of the calling thread by linear
+    // probing from the slot after its last claim. nullptr once the thread
+    // has exited, or if no shard can be allocated.
+    static live_slot* join(const char* file, unsigned line, bool has_value, std::uint64_t value) noexcept
+    {
+        thread_local_state& s = state();
+        if(!s.shard) {
+            if(s.exited) {
+                return nullptr;
+            }
+            static thread_local owner o;
+            (void)o;
+        }
+        live_slot* slot = s.shard ? s.shard->claim() : nullptr;
+        if(!slot) {
+            slot = claim_elsewhere(s);
+            if(!slot) {
+                return nullptr;
+            }
+        }
+        slot->file.store(file, std::memory_order_relaxed);
+        slot->line.store(line | (has_value ? std::uint64_t(1) << 32 : 0), std::memory_order_relaxed);
+        slot->value.store(value, std::memory_order_relaxed);
+        slot->acquired.store(now(), std::memory_order_relaxed);
+        slot->state.store(slot->state.load(std::memory_order_relaxed) + (phase_live - phase_writing), std::memory_order_release);
+        return slot;
+    }
+
+    template <typename F>
+    void for_each(F&& f) const
+    {
+        for(const live_slot& s : slots_) {
+            f(s);
+        }
+    }
+
+private:
+    struct thread_local_state
+    {
+        live_shard* shard;
+        bool exited;
+    };
+
+    // Gives the shard back when the thread exits. The state has a trivial
+    // destructor, so resources destroyed later on the thread still see it.
+    struct owner
+    {
+        ~owner()
+        {
+            thread_local_state& s = state();
+            if(s.shard) {
+                s.shard->in_use_.store(false, std::memory_order_release);
+            }
+            s.shard = nullptr;
+            s.exited = true;
+        }
+    };
+
+    static thread_local_state& state() noexcept
+    {
+        static thread_local thread_local_state s{nullptr, false};
+        return s;
+    }
+
+    // The thread has no shard yet, or its shard is full: it gives it up
+    // for the first shard with a free slot which no thread owns, or for a
+    // new one. This is once in many claims, but may probe every shard.
+    static live_slot* claim_elsewhere(thread_local_state& s) noexcept
+    {
+        live_shard* full = s.shard;
+        if(full) {
+            full->in_use_.store(false, std::memory_order_release);
+        }
+        s.shard = nullptr;
+        std::atomic<live_shard*>& h = head();
+        for(live_shard* r = h.load(std::memory_order_acquire); r; r = r->next_) {
+            bool expected = false;
+            if(r != full && r->in_use_.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                if(live_slot* slot = r->claim()) {
+                    s.shard = r;
+                    return slot;
+                }
+                r->in_use_.store(false, std::memory_order_release);
+            }
+        }
+        s.shard = allocate();
+        return s.shard ? s.shard->claim() : nullptr;
+    }
+
+    static live_shard* allocate() noexcept
+    {
+        std::atomic<live_shard*>& h = head();
+        // Placed on a cache line boundary by hand: new does not honor the
+        // alignment of over aligned types before C++17.
+        void* p = ::operator new(sizeof(live_shard) + line_size, std::nothrow);
+        if(!p) {
+            return nullptr;
+        }
+        const std::uintptr_t a = (reinterpret_cast<std::uintptr_t>(p) + line_size) & ~std::uintptr_t(line_size - 1);
+        live_shard* r = ::new(reinterpret_cast<void*>(a)) live_shard{};
+        r->next_ = h.load(std::memory_order_relaxed);
+        while(!h.compare_exchange_weak(r->next_, r, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        return r;
+    }
+
+    // A free slot, in its writing phase, or nullptr if the shard is full.
+    live_slot* claim() noexcept
+    {
+        for(std::size_t n = 0; n < capacity; ++n) {
+            live_slot& s = slots_[cursor_];
+            if(++cursor_ == capacity) {
+                cursor_ = 0;
+            }
+            const std::uint64_t st = s.state.load(std::memory_order_acquire);
+            if((st & phase_mask) == phase_free) {
+                s.state.store(st + phase_writing, std::memory_order_relaxed);
+                // Orders the writing phase before the fields, for readers
+                // which see a field of this use of the slot.
+                std::atomic_thread_fence(std::memory_order_release);
+                return &s;
+            }
+        }
+        return nullptr;
+    }
+
+    live_slot slots_[capacity];
+    std::size_t cursor_{0};
+    std::atomic<bool> in_use_{true};
+    live_shard* next_{nullptr};
+};
+
+// The resources which are live but have no slot, no shard having been
+// available when they were acquired.
+inline std::atomic<std::uint64_t>& untracked() noexcept
+{
+    static std::atomic<std::uint64_t> n{0};
+    return n;
+}
+
+// The slot of the resources counted in untracked().
+inline live_slot* untracked_slot() noexcept
+{
+    static live_slot s;
+    return &s;
+}
+
+inline live_slot* join(const char* file, unsigned line, bool has_value, std::uint64_t value) noexcept
+{
+    if(live_slot* s = live_shard::join(file, line, has_value, value)) {
+        return s;
+    }
+    untracked().fetch_add(1, std::memory_order_relaxed);
+    return untracked_slot();
+}
+
+inline void leave(live_slot* s) noexcept
+{
+    if(s == untracked_slot()) {
+        untracked().fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+    // From the live phase of one use to the free phase of the next.
+    s->state.store(s->state.load(std::memory_order_relaxed) + (phase_mask + 1 - phase_live), std::memory_order_release);
+}
+
+// The value of a resource which is an integer, an enumeration or a
+// pointer, such as a file descriptor or a handle, is kept with it.
+template <typename T, typename = void>
+struct live_value
+{
+    static constexpr bool stored = false;
+    static std::uint64_t get(const T&) noexcept { return 0; }
+};
+
+template <typename T>
+struct live_value<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type>
+{
+    static constexpr bool stored = true;
+    static std::uint64_t get(const T& v) noexcept { return static_cast<std::uint64_t>(v); }
+};
+
+template <typename T>
+struct live_value<T*, void>
+{
+    static constexpr bool stored = true;
+    static std::uint64_t get(T* v) noexcept { return reinterpret_cast<std::uintptr_t>(v); }
+};
+
+// The slot of one unique_resource, which moves with it. It is empty while
+// the unique_resource owns nothing.
+class live_entry
+{
+public:
+    live_entry() noexcept = default;
+
+    live_entry(live_entry&& rhs) noexcept
+        : slot_{rhs.slot_}
+    {
+        rhs.slot_ = nullptr;
+    }
+
+    // The entry has been left before.
+    live_entry& operator=(live_entry&& rhs) noexcept
+    {
+        slot_ = rhs.slot_;
+        rhs.slot_ = nullptr;
+        return *this;
+    }
+
+    template <typename R>
+    void join(const char* file, unsigned line, const R& r) noexcept
+    {
+        using traits = live_value<typename std::remove_cv<R>::type>;
+        slot_ = live_detail::join(file, line, traits::stored, traits::get(r));
+    }
+
+    void leave() noexcept
+    {
+        if(slot_) {
+            live_detail::leave(slot_);
+            slot_ = nullptr;
+        }
+    }
+
+private:
+    live_slot* slot_{nullptr};
+};
+
+// A live resource: the site which acquired it, its value if it has one,
+// and its age, at the resolution of the coarse clock.
+struct live_resource
+{
+    const char* file;
+    unsigned line;
+    bool has_value;
+    std::uint64_t value;
+    std::uint64_t age_ns;
+};
+
+// The live resources at least min_age_ns old, oldest first, into out. out
+// is cleared first and its storage reused. The table is read without
+// stopping its writers: a resource acquired or released meanwhile may or
+// may not be listed, but no entry is torn.
+inline void live_resources_snapshot(std::vector<live_resource>& out, std::uint64_t min_age_ns = 0)
+{
+    out.clear();
+    const std::uint64_t t = now();
+    for(live_shard* r = live_shard::head().load(std::memory_order_acquire); r; r = r->next()) {
+        r->for_each([&](const live_slot& s) {
+            const std::uint64_t st = s.state.load(std::memory_order_acquire);
+            if((st & phase_mask) != phase_live) {
+                return;
+            }
+            const char* file = s.file.load(std::memory_order_relaxed);
+            const std::uint64_t line = s.line.load(std::memory_order_relaxed);
+            const std::uint64_t value = s.value.load(std::memory_order_relaxed);
+            const std::uint64_t acquired = s.acquired.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(s.state.load(std::memory_order_relaxed) != st) {
+                return;
+            }
+            const std::uint64_t age = t > acquired ? t - acquired : 0;
+            if(age >= min_age_ns) {
+                out.push_back(live_resource{file, static_cast<unsigned>(line), (line >> 32) != 0, value, age});
+            }
+        });
+    }
+    std::sort(out.begin(), out.end(), [](const live_resource& a, const live_resource& b) {
+        return a.age_ns > b.age_ns;
+    });
+}
+
+inline std::vector<live_resource> live_resources_snapshot(std::uint64_t min_age_ns = 0)
+{
+    std::vector<live_resource> out;
+    live_resources_snapshot(out, min_age_ns);
+    return out;
+}
+
+// The live resources which are not in the snapshot, no shard having been
+// available when they were acquired.
+inline std::uint64_t live_resources_untracked() noexcept
+{
+    return untracked().load(std::memory_order_relaxed);
+}
+
+// One line per live resource at least min_age_ns old: its site, value and
+// age in milliseconds.
+inline std::string live_resources_report_text(std::uint64_t min_age_ns = 0)
+{
+    std::string out;
+    char site[256];
+    char buf[512];
+    std::snprintf(buf, sizeof(buf), "%-48s %20s %14s\n", "site", "value", "age_ms");
+    out += buf;
+    for(const live_resource& r : live_resources_snapshot(min_age_ns)) {
+        std::snprintf(site, sizeof(site), "%s:%u", r.file ? r.file : "?", r.line);
+        if(r.has_value) {
+            std::snprintf(buf, sizeof(buf), "%-48s %20llu %14.3f\n", site, static_cast<unsigned long long>(r.value), r.age_ns / 1e6);
+        }
+        else {
+            std::snprintf(buf, sizeof(buf), "%-48s %20s %14.3f\n", site, "-", r.age_ns / 1e6);
+        }
+        out += buf;
+    }
+    if(const std::uint64_t n = live_resources_untracked()) {
+        std::snprintf(buf, sizeof(buf), "untracked: %llu\n", static_cast<unsigned long long>(n));
+        out += buf;
+    }
+    return out;
+}
+
+} // namespace live_detail
+
+using live_detail::live_resource;
+using live_detail::live_resources_snapshot;
+using live_detail::live_resources_untracked;
+using live_detail::live_resources_report_text;
+
+} // namespace scope
+
+#endif // NAKATT_SCOPE_LIVE_REGISTRY_HPP_
@@ -0,0 +1,382 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_SCOPE_REAPER_HPP_
+#define NAKATT_SCOPE_REAPER_HPP_
+
+#include "scope.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace scope {
+
+// What reaper::post() does when the queue is full.
+enum class reaper_overflow
+{
+    run_inline, // call the job on the posting thread
+    block,      // wait until the reaper thread makes room
+};
+
+namespace detail {
+
+// A bounded multi-producer single-consumer queue of jobs stored in
+// callback_slots, after Dmitry Vyukov's bounded MPMC queue. A producer claims
+// the cell at tail_ and publishes it by storing pos + 1 into its sequence;
+// the consumer frees it for the next round by storing pos + capacity.
+class job_queue
+{
+public:
+    // capacity is rounded up to a power of 2.
+    explicit job_queue(std::size_t capacity)
+        : mask_{round_up(capacity) - 1}
+        , cells_{new cell[mask_ + 1]}
+    {
+        for(std::size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    job_queue(const job_queue&) = delete;
+    job_queue& operator=(const job_queue&) = delete;
+
+    ~job_queue()
+    {
+        delete[] cells_;
+    }
+
+    // Moves f into the queue. f is left untouched if the queue is full.
+    template <typename F>
+    bool try_push(F& f) noexcept
+    {
+        static_assert(is_inline_callback<F>::value, "F must be stored in place");
+        cell* c;
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for(;;) {
+            c = &cells_[pos & mask_];
+            const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+            const std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if(diff == 0) {
+                if(tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if(diff < 0) {
+                return false;
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        callback_traits<F>::construct(c->slot.storage, std::move(f));
+        c->slot.ops = callback_traits<F>::template ops<0>();
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Calls and drops the oldest job, if any. Only one thread at a time may
+    // call this.
+    bool pop_and_run()
+    {
+        const std::size_t pos = head_.load(std::memory_order_relaxed);
+        cell& c = cells_[pos & mask_];
+        if(c.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        auto free_cell = make_untracked_scope_exit([this, &c, pos]() noexcept {
+            if(c.slot.ops->destroy) {
+                c.slot.ops->destroy(c.slot.storage);
+            }
+            c.sequence.store(pos + mask_ + 1, std::memory_order_release);
+            head_.store(pos + 1, std::memory_order_release);
+        });
+        c.slot.ops->invoke(c.slot.storage);
+        return true;
+    }
+
+    bool empty() const noexcept
+    {
+        const std::size_t pos = head_.load(std::memory_order_acquire);
+        return cells_[pos & mask_].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    // The number of jobs claimed and finished so far.
+    std::size_t tail() const noexcept { return tail_.load(std::memory_order_acquire); }
+    std::size_t head() const noexcept { return head_.load(std::memory_order_acquire); }
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+    struct cell
+    {
+        std::atomic<std::size_t> sequence;
+        callback_slot slot;
+    };
+
+    static std::size_t round_up(std::size_t n) noexcept
+    {
+        std::size_t r = 2;
+        while(r < n) {
+            r *= 2;
+        }
+        return r;
+    }
+
+    const std::size_t mask_;
+    cell* const cells_;
+    // Producers and the consumer write to separate cache lines.
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::atomic<std::size_t> head_{0};
+};
+
+// A job too large for a queue cell, moved to the heap so that the queue
+// only holds a pointer to it.
+template <typename F>
+struct heap_job
+{
+    std::unique_ptr<F> f;
+
+    void operator()() { (*f)(); }
+};
+
+} // namespace detail
+
+// A thread which runs jobs posted by other threads, e.g. to close or free
+// resources away from latency critical threads. While jobs keep coming, the
+// reaper thread wakes up every interval and runs every job it finds, and
+// post() makes no system call: it only wakes the reaper thread early when
+// the queue is half full. A reaper thread which found nothing to do for an
+// interval sleeps until the next post(), which wakes it.
+//
+// A job must not throw: an exception leaving a job on the reaper thread
+// calls std::terminate(), as it would leaving a destructor.
+class reaper
+{
+public:
+    explicit reaper(std::size_t capacity = 1024,
+                    reaper_overflow overflow = reaper_overflow::run_inline,
+                    std::chrono::microseconds interval = std::chrono::milliseconds(1))
+        : queue_{capacity}
+        , overflow_{overflow}
+        , interval_{interval}
+        , thread_{[this]{ run(); }}
+    {}
+
+    reaper(const reaper&) = delete;
+    reaper& operator=(const reaper&) = delete;
+
+    // Runs every job posted so far, then stops the reaper thread.
+    ~reaper()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stop_ = true;
+        }
+        wakeup_.notify_one();
+        thread_.join();
+    }
+
+    // Queues f to be called on the reaper thread. If the queue is full, f is
+    // called here or the caller waits, depending on the overflow policy. A job
+    // which does not fit in a queue cell is moved to the heap.
+    template <typename F>
+    void post(F&& f)
+    {
+        using EF = detail::decay_t<F>;
+        post_(std::forward<F>(f), detail::is_inline_callback<EF>{});
+    }
+
+    // Waits until the reaper thread has run every job posted before this
+    // call. Called from a job, it returns at once: the jobs posted before it
+    // run after the current one.
+    void flush()
+    {
+        if(on_reaper_thread()) {
+            return;
+        }
+        const std::size_t target = queue_.tail();
+        wake();
+        std::unique_lock<std::mutex> lock{mutex_};
+        done_.wait(lock, [this, target]{ return queue_.head() >= target; });
+    }
+
+    // Runs the queued jobs on the calling thread. Called from a job, it does
+    // nothing.
+    void drain()
+    {
+        if(on_reaper_thread()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock{consumer_mutex_};
+            while(queue_.pop_and_run()) {}
+        }
+        std::lock_guard<std::mutex> lock{mutex_};
+        done_.notify_all();
+    }
+
+    // The number of queued jobs, including the running one.
+    std::size_t pending() const noexcept { return queue_.tail() - queue_.head(); }
+
+    std::size_t capacity() const noexcept { return queue_.capacity(); }
+
+private:
+    template <typename F>
+    void post_(F&& f, std::true_type)
+    {
+        detail::decay_t<F> job(std::forward<F>(f));
+        while(!queue_.try_push(job)) {
+            // A job posting to its own full queue would wait for itself.
+            if(overflow_ == reaper_overflow::run_inline || on_reaper_thread()) {
+                job();
+                return;
+            }
+            wake();
+            std::this_thread::yield();
+        }
+        // Pairs with the fence in run(): either the reaper thread sees the
+        // job, or this sees that it is idle.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(idle_.load(std::memory_order_relaxed)) {
+            if(idle_.exchange(false, std::memory_order_relaxed)) {
+                wake();
+            }
+        }
+        else if(pending() >= queue_.capacity() / 2 && sleeping_.exchange(false, std::memory_order_relaxed)) {
+            wake();
+        }
+    }
+
+    template <typename F>
+    void post_(F&& f, std::false_type)
+    {
+        using EF = detail::decay_t<F>;
+        post_(detail::heap_job<EF>{std::unique_ptr<EF>{new EF(std::forward<F>(f))}}, std::true_type{});
+    }
+
+    void wake()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        woken_ = true;
+        wakeup_.notify_one();
+    }
+
+    bool on_reaper_thread() const noexcept
+    {
+        return std::this_thread::get_id() == thread_.get_id();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        for(;;) {
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> consumer{consumer_mutex_};
+                while(queue_.pop_and_run()) {}
+            }
+            lock.lock();
+            done_.notify_all();
+            if(stop_) {
+                if(queue_.empty()) {
+                    return;
+                }
+                continue;
+            }
+            sleeping_.store(true, std::memory_order_relaxed);
+            wakeup_.wait_for(lock, interval_, [this]{ return stop_ || woken_; });
+            sleeping_.store(false, std::memory_order_relaxed);
+            if(!stop_ && !woken_ && queue_.empty()) {
+                // Nothing came for an interval: sleep until post() wakes the thread.
+                idle_.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                wakeup_.wait(lock, [this]{ return stop_ || woken_ || !queue_.empty(); });
+                idle_.store(false, std::memory_order_relaxed);
+            }
+            woken_ = false;
+        }
+    }
+
+    detail::job_queue queue_;
+    const reaper_overflow overflow_;
+    const std::chrono::microseconds interval_;
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> idle_{false};
+    bool stop_{false};
+    bool woken_{false};
+    std::mutex mutex_;
+    std::mutex consumer_mutex_;
+    std::condition_variable wakeup_;
+    std::condition_variable done_;
+    std::thread thread_;
+};
+
+// The reaper used by default, stopped at exit.
+inline reaper& default_reaper()
+{
+    static reaper r;
+    return r;
+}
+
+// A deleter which hands the resource to a reaper, which calls D on it on
+// the reaper thread: unique_resource<int, deferred_deleter<close_fd>> closes
+// its fd without blocking the thread which resets or destroys it. The
+// resource is copied into the job. The reaper is always given, e.g.
+// default_reaper(), so that making a deleter does not start a thread
+// behind the caller's back.
+template <typename D>
+class deferred_deleter
+{
+public:
+    explicit deferred_deleter(reaper& r)
+        : deleter_()
+        , reaper_{&r}
+    {}
+
+    deferred_deleter(const D& d, reaper& r)
+        : deleter_(d)
+        , reaper_{&r}
+    {}
+
+    template <typename R>
+    void operator()(const R& resource) const
+    {
+        const D& d = deleter_;
+        reaper_->post([resource, d]() mutable { d(resource); });
+    }
+
+    const D& deleter() const noexcept { return deleter_; }
+    reaper& get_reaper() const noexcept { return *reaper_; }
+
+private:
+    D deleter_;
+    reaper* reaper_;
+};
+
+} // namespace scope
+
+#endif // NAKATT_SCOPE_REAPER_HPP_
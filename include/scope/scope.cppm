@@ -0,0 +1,75 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The module scope, for C++20: `import scope;` instead of
+// `#include <scope/scope.hpp>`. It exports scope_exit, scope_fail,
+// scope_success, unique_resource, null_resource_policy and their make_*
+// factories. Macros are not exported: SCOPE_USE_SUCCESS_FAIL,
+// SCOPE_USE_DEDUCTION_GUIDE and SCOPE_USE_STATIC_DELETER all hold in C++20.
+// Build it with the options of the translation units which import it.
+module;
+
+// The standard headers which scope.hpp includes with the same options, so
+// that its includes are skipped in the module purview. Only those: GCC 12
+// fails on the importers of a module which includes more.
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(SCOPE_ENABLE_USDT)
+#include <memory>
+#endif // defined(SCOPE_ENABLE_USDT)
+
+#if defined(SCOPE_ENABLE_INSTRUMENTATION)
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#endif // defined(SCOPE_ENABLE_INSTRUMENTATION)
+
+#if defined(SCOPE_ENABLE_LIVE_REGISTRY)
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <time.h>
+#else
+#include <chrono>
+#endif
+#endif // defined(SCOPE_ENABLE_LIVE_REGISTRY)
+
+#if defined(SCOPE_ENABLE_EXTERN_TEMPLATES) || defined(SCOPE_INSTANTIATE_EXTERN_TEMPLATES)
+#include <cstdio>
+#include <functional>
+#endif // defined(SCOPE_ENABLE_EXTERN_TEMPLATES) || defined(SCOPE_INSTANTIATE_EXTERN_TEMPLATES)
+
+export module scope;
+
+#define SCOPE_EXPORT export
+#include "scope.hpp"
@@ -22,12 +22,31 @@
 #ifndef NAKATT_SCOPE_HPP_
 #define NAKATT_SCOPE_HPP_
 
+#include <climits>
 #include <cstddef>
+#include <cstring>
 #include <exception>
-#include <functional>
+#include <new>
 #include <type_traits>
 #include <utility>
 
+#if defined(SCOPE_ENABLE_USDT)
+#include <memory>
+#endif // defined(SCOPE_ENABLE_USDT)
+
+#if defined(SCOPE_ENABLE_INSTRUMENTATION)
+#include "instrumentation.hpp"
+#endif // defined(SCOPE_ENABLE_INSTRUMENTATION)
+
+#if defined(SCOPE_ENABLE_LIVE_REGISTRY)
+#include "live_registry.hpp"
+#endif // defined(SCOPE_ENABLE_LIVE_REGISTRY)
+
+#if defined(SCOPE_ENABLE_EXTERN_TEMPLATES) || defined(SCOPE_INSTANTIATE_EXTERN_TEMPLATES)
+#include <cstdio>
+#include <functional>
+#endif // defined(SCOPE_ENABLE_EXTERN_TEMPLATES) || defined(SCOPE_INSTANTIATE_EXTERN_TEMPLATES)
+
 #define SCOPE_VERSION_MAJOR 0
 #define SCOPE_VERSION_MINOR 9
 #define SCOPE_VERSION_PATCH 0
@@ -36,7 +55,33 @@
 #define SCOPE_VERSION_(major, minor, patch) SCOPE_STR(major) "." SCOPE_STR(minor) "." SCOPE_STR(patch)
 #define SCOPE_VERSION SCOPE_VERSION_(SCOPE_VERSION_MAJOR, SCOPE_VERSION_MINOR, SCOPE_VERSION_PATCH)
 
-#if defined(__cpp_lib_uncaught_exceptions)
+// SCOPE_NO_EXCEPTIONS is defined when exceptions are disabled
+// (-fno-exceptions). No scope is then left by an exception: scope_success
+// calls its exit function as scope_exit does, scope_fail never does, and
+// neither calls std::uncaught_exceptions(), so both are available in C++11.
+// The handlers which call an exit function that could not be stored are
+// compiled out, as a failed copy or allocation terminates. Defining it
+// where exceptions are enabled is an error: scope_fail would not be called
+// on an exception.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#   if defined(SCOPE_NO_EXCEPTIONS)
+#       error "SCOPE_NO_EXCEPTIONS is defined, but exceptions are enabled"
+#   endif
+#elif !defined(SCOPE_NO_EXCEPTIONS)
+#   define SCOPE_NO_EXCEPTIONS
+#endif
+
+#if defined(SCOPE_NO_EXCEPTIONS)
+#   define SCOPE_TRY if(true)
+#   define SCOPE_CATCH_ALL if(false)
+#   define SCOPE_RETHROW
+#else
+#   define SCOPE_TRY try
+#   define SCOPE_CATCH_ALL catch(...)
+#   define SCOPE_RETHROW throw
+#endif
+
+#if defined(__cpp_lib_uncaught_exceptions) || defined(SCOPE_NO_EXCEPTIONS)
 #   define SCOPE_USE_SUCCESS_FAIL
 #endif
 
@@ -44,8 +89,176 @@
     #define SCOPE_USE_DEDUCTION_GUIDE
 #endif
 
+#if defined(__cpp_nontype_template_parameter_auto)
+#   define SCOPE_USE_STATIC_DELETER
+#endif
+
+// Constraints are requires-clauses where concepts are available, which
+// GCC checks faster than defaulted enable_if_t parameters. Defining
+// SCOPE_NO_CONCEPTS keeps enable_if_t, to compare the two.
+#if defined(__cpp_concepts) && __cpp_concepts >= 201907L && !defined(SCOPE_NO_CONCEPTS)
+#   define SCOPE_USE_CONCEPTS
+#endif
+
+#if defined(__cpp_lib_is_final)
+#   define SCOPE_IS_FINAL(T) std::is_final<T>::value
+#elif defined(__GNUC__) || defined(__clang__)
+#   define SCOPE_IS_FINAL(T) __is_final(T)
+#endif
+
+// SCOPE_TEMPLATE((parameters), condition) is the head of a template which
+// takes part in overload resolution only if condition holds.
+#define SCOPE_UNPAREN(...) __VA_ARGS__
+#if defined(SCOPE_USE_CONCEPTS)
+#   define SCOPE_TEMPLATE(params, ...) template <SCOPE_UNPAREN params> requires (__VA_ARGS__)
+#else
+#   define SCOPE_TEMPLATE(params, ...) template <SCOPE_UNPAREN params, enable_if_t<(__VA_ARGS__), std::nullptr_t> = nullptr>
+#endif
+
+// scope.cppm, the module scope, includes this header with SCOPE_EXPORT
+// defined to export, which exports the guards, unique_resource and their
+// factories.
+#if !defined(SCOPE_EXPORT)
+#   define SCOPE_EXPORT
+#endif
+
+// SCOPE_ENABLE_INSTRUMENTATION counts, per thread and per call site, how
+// many guards are created, released and fired. The call site is a default
+// argument of the constructors and factories, which SCOPE_SITE_PARAM
+// declares and SCOPE_SITE_ARG passes on; SCOPE_PROBE(...) keeps its
+// argument only in an instrumented build. The counters are in
+// instrumentation.hpp, included only with the option.
+#if defined(SCOPE_ENABLE_INSTRUMENTATION)
+#   define SCOPE_SITE_PARAM , ::scope::detail::guard_site site = ::scope::detail::guard_site::current()
+#   define SCOPE_SITE_ARG , site
+#   define SCOPE_PROBE(...) __VA_ARGS__
+#else
+#   define SCOPE_SITE_PARAM
+#   define SCOPE_SITE_ARG
+#   define SCOPE_PROBE(...)
+#endif
+
+// SCOPE_ENABLE_LIVE_REGISTRY keeps every unique_resource which owns a
+// resource in a registry of live resources, with the site and the time of
+// its acquisition. The registry is in live_registry.hpp, included only
+// with the option. unique_resource takes its site from
+// SCOPE_RESOURCE_SITE_PARAM, which either option declares; SCOPE_LIVE(...)
+// keeps its argument only with the registry.
+#if defined(SCOPE_ENABLE_INSTRUMENTATION) || defined(SCOPE_ENABLE_LIVE_REGISTRY)
+#   define SCOPE_RESOURCE_SITE_PARAM , ::scope::detail::guard_site site = ::scope::detail::guard_site::current()
+#   define SCOPE_RESOURCE_SITE_ARG , site
+#else
+#   define SCOPE_RESOURCE_SITE_PARAM
+#   define SCOPE_RESOURCE_SITE_ARG
+#endif
+
+#if defined(SCOPE_ENABLE_LIVE_REGISTRY)
+#   define SCOPE_LIVE(...) __VA_ARGS__
+#else
+#   define SCOPE_LIVE(...)
+#endif
+
+// SCOPE_ENABLE_EXTERN_TEMPLATES declares the guards of function pointers and
+// std::function, and unique_resource of file descriptors, FILE* and void*,
+// as extern templates: their members which are not inlined are then emitted
+// once, by the translation unit built with SCOPE_INSTANTIATE_EXTERN_TEMPLATES,
+// instead of in every translation unit which uses them. Both units must be
+// built with the same options.
+#if defined(SCOPE_INSTANTIATE_EXTERN_TEMPLATES)
+#   define SCOPE_EXTERN_TEMPLATE template
+#elif defined(SCOPE_ENABLE_EXTERN_TEMPLATES)
+#   define SCOPE_EXTERN_TEMPLATE extern template
+#endif
+
+// SCOPE_ENABLE_USDT places static probes of the provider "scope" in the
+// guards, in the format of systemtap's <sys/sdt.h>, for perf, bpftrace and
+// systemtap to attach to. A probe is a nop and a note in .note.stapsdt, with
+// no semaphore: its arguments are left where the compiler has them. Every
+// probe has three arguments: the guard_kind, the address of the exit
+// function or deleter, and whether it is called. SCOPE_HAS_USDT is defined
+// where the probes are supported, x86-64 ELF with GCC or Clang.
+#if defined(SCOPE_ENABLE_USDT) && defined(__ELF__) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#   define SCOPE_HAS_USDT
+#   define SCOPE_USDT(name, kind, address, called) \
+        __asm__ __volatile__( \
+            "990: nop\n" \
+            ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+            ".balign 4\n" \
+            ".4byte 992f-991f, 994f-993f, 3\n" \
+            "991: .asciz \"stapsdt\"\n" \
+            "992: .balign 4\n" \
+            "993: .8byte 990b\n" \
+            ".8byte _.stapsdt.base\n" \
+            ".8byte 0\n" \
+            ".asciz \"scope\"\n" \
+            ".asciz \"" #name "\"\n" \
+            ".asciz \"-4@%[k] 8@%[a] 1@%[c]\"\n" \
+            "994: .balign 4\n" \
+            ".popsection\n" \
+            ".ifndef _.stapsdt.base\n" \
+            ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+            ".weak _.stapsdt.base\n" \
+            ".hidden _.stapsdt.base\n" \
+            "_.stapsdt.base: .space 1\n" \
+            ".size _.stapsdt.base, 1\n" \
+            ".popsection\n" \
+            ".endif\n" \
+            : \
+            : [k] "nor"(static_cast<int>(kind)), \
+              [a] "nor"(::scope::detail::probe_address(address)), \
+              [c] "nor"(static_cast<unsigned char>(called)))
+#else
+#   define SCOPE_USDT(name, kind, address, called) static_cast<void>(0)
+#endif
+
 namespace scope {
 
+// The kind of a guard, as counted by the instrumentation and passed to the
+// USDT probes. The values are part of the probe interface. It is the same
+// with every option, outside of the inline namespaces below.
+enum class guard_kind
+{
+    scope_guard     = 0,
+    scope_exit      = 1,
+    scope_fail      = 2,
+    scope_success   = 3,
+    unique_resource = 4,
+};
+
+inline const char* guard_kind_name(guard_kind kind) noexcept
+{
+    switch(kind) {
+    case guard_kind::scope_exit:      return "scope_exit";
+    case guard_kind::scope_fail:      return "scope_fail";
+    case guard_kind::scope_success:   return "scope_success";
+    case guard_kind::unique_resource: return "unique_resource";
+    default:                          return "scope_guard";
+    }
+}
+
+// Instrumented guards, and registered unique_resource, have another layout.
+// They live in an inline namespace of their own, so that translation units
+// built with and without these options can be linked together.
+#if defined(SCOPE_ENABLE_INSTRUMENTATION) && defined(SCOPE_ENABLE_LIVE_REGISTRY)
+inline namespace instrumented_registered {
+#elif defined(SCOPE_ENABLE_INSTRUMENTATION)
+inline namespace instrumented {
+#elif defined(SCOPE_ENABLE_LIVE_REGISTRY)
+inline namespace registered {
+#endif
+
+// Without exceptions, scope_success and scope_fail have another layout and
+// are called in other cases: the guards live in an inline namespace nested
+// in the one above.
+#if defined(SCOPE_NO_EXCEPTIONS)
+inline namespace noexcept_ {
+#endif
+
+// So do the guards with USDT probes, whose members have other bodies.
+#if defined(SCOPE_HAS_USDT)
+inline namespace usdt {
+#endif
+
 namespace detail {
 
 template <typename T>
@@ -79,18 +292,173 @@ constexpr typename std::add_const<T>::type& as_const(T& t) noexcept
 template <typename T>
 void as_const(const T&&) = delete;
 
-struct strategy_exit
+#if defined(SCOPE_IS_FINAL)
+template <typename T>
+struct is_ebo_candidate
+    : public std::integral_constant<bool, std::is_class<T>::value && std::is_empty<T>::value && !SCOPE_IS_FINAL(T)>
+{};
+#else
+template <typename T>
+struct is_ebo_candidate : public std::false_type {};
+#endif // defined(SCOPE_IS_FINAL)
+
+// Holds a T, as a base class when T is empty so that it takes no space.
+// Tag keeps two storages of the same T distinct inside one object.
+template <typename T, typename Tag = void, bool = is_ebo_candidate<T>::value>
+class compressed_storage
+{
+public:
+    template <typename U>
+    explicit compressed_storage(U&& value) noexcept(std::is_nothrow_constructible<T, U>::value)
+        : value_{std::forward<U>(value)}
+    {}
+
+    // Releases g once the value is constructed, see resource_wrapper.
+    template <typename Guard, typename U>
+    compressed_storage(Guard&& g, U&& value) noexcept(std::is_nothrow_constructible<T, U>::value)
+        : value_{std::forward<U>(value)}
+    {
+        g.release();
+    }
+
+    T&       get() noexcept       { return value_; }
+    const T& get() const noexcept { return value_; }
+
+private:
+    T value_;
+};
+
+template <typename T, typename Tag>
+class compressed_storage<T, Tag, true> : private T
+{
+public:
+    template <typename U>
+    explicit compressed_storage(U&& value) noexcept(std::is_nothrow_constructible<T, U>::value)
+        : T(std::forward<U>(value))
+    {}
+
+    template <typename Guard, typename U>
+    compressed_storage(Guard&& g, U&& value) noexcept(std::is_nothrow_constructible<T, U>::value)
+        : T(std::forward<U>(value))
+    {
+        g.release();
+    }
+
+    T&       get() noexcept       { return *this; }
+    const T& get() const noexcept { return *this; }
+};
+
+#if defined(SCOPE_ENABLE_USDT)
+// The address of an exit function or deleter, for the probes.
+template <typename T>
+const void* probe_address(const T& t) noexcept
+{
+    return static_cast<const void*>(std::addressof(t));
+}
+
+template <typename R, typename... Args>
+const void* probe_address(R (&f)(Args...)) noexcept
+{
+    return reinterpret_cast<const void*>(&f);
+}
+
+// A function pointer stored in the guard: the function it points to, not
+// the pointer.
+template <typename R, typename... Args>
+const void* probe_address(R (*const& f)(Args...)) noexcept
+{
+    return reinterpret_cast<const void*>(f);
+}
+
+#if defined(__cpp_noexcept_function_type)
+template <typename R, typename... Args>
+const void* probe_address(R (&f)(Args...) noexcept) noexcept
+{
+    return reinterpret_cast<const void*>(&f);
+}
+
+template <typename R, typename... Args>
+const void* probe_address(R (*const& f)(Args...) noexcept) noexcept
+{
+    return reinterpret_cast<const void*>(f);
+}
+#endif // defined(__cpp_noexcept_function_type)
+#endif // defined(SCOPE_ENABLE_USDT)
+
+#if defined(SCOPE_ENABLE_INSTRUMENTATION) || defined(SCOPE_ENABLE_LIVE_REGISTRY)
+
+// The source location which created a guard. A site without a file, as the
+// guards used by the library itself have, is not counted.
+struct guard_site
+{
+    const char* file;
+    unsigned line;
+
+    // Only a default argument of its own takes the location of the caller:
+    // in guard_site{__builtin_FILE(), ...} it would be this header.
+    static guard_site current(const char* file = __builtin_FILE(), unsigned line = __builtin_LINE()) noexcept
+    {
+        return guard_site{file, line};
+    }
+};
+
+#endif // defined(SCOPE_ENABLE_INSTRUMENTATION) || defined(SCOPE_ENABLE_LIVE_REGISTRY)
+
+#if defined(SCOPE_ENABLE_INSTRUMENTATION)
+
+// Whether the guard fires during stack unwinding, for the counters.
+inline bool unwinding() noexcept
+{
+#if defined(SCOPE_NO_EXCEPTIONS)
+    return false;
+#elif defined(SCOPE_USE_SUCCESS_FAIL)
+    return std::uncaught_exceptions() > 0;
+#else
+    return std::uncaught_exception();
+#endif
+}
+
+#endif // defined(SCOPE_ENABLE_INSTRUMENTATION)
+
+// A Strategy decides whether scope_guard<EF, Strategy> calls its exit function.
+// It provides
+//   bool call_when_dtor() const noexcept;             // on destruction
+//   bool call_when_construct_failed() const noexcept; // when EF could not be copied
+// and optionally
+//   void release() noexcept;
+// in which case it stores the armed flag of the guard itself. A strategy is
+// passed to the constructor of scope_guard, or default constructed, and must be
+// nothrow copy and move constructible.
+SCOPE_EXPORT struct strategy_exit
 {
     constexpr bool call_when_dtor() const noexcept { return true; }
     constexpr bool call_when_construct_failed() const noexcept { return true; }
 };
 
-#if defined(SCOPE_USE_SUCCESS_FAIL)
+#if defined(SCOPE_NO_EXCEPTIONS)
+struct strategy_success
+{
+    constexpr bool call_when_dtor() const noexcept { return true; }
+    constexpr bool call_when_construct_failed() const noexcept { return false; }
+};
+
+// Never armed, so it needs no flag.
+struct strategy_fail
+{
+    constexpr bool call_when_dtor() const noexcept { return false; }
+    constexpr bool call_when_construct_failed() const noexcept { return true; }
+    void           release() noexcept {}
+};
+#elif defined(SCOPE_USE_SUCCESS_FAIL)
+// strategy_success and strategy_fail keep the armed flag of the guard in
+// uncaught_on_creation_: release() moves it out of the range of
+// std::uncaught_exceptions(), so that call_when_dtor() never holds again.
 struct strategy_success
 {
     int uncaught_on_creation_{std::uncaught_exceptions()};
     bool           call_when_dtor() const noexcept { return std::uncaught_exceptions() <= uncaught_on_creation_; }
     constexpr bool call_when_construct_failed() const noexcept { return false; }
+    void           release() noexcept { uncaught_on_creation_ = -1; }
 };
 
 struct strategy_fail
@@ -98,95 +466,247 @@ struct strategy_fail
     int uncaught_on_creation_{std::uncaught_exceptions()};
     bool           call_when_dtor() const noexcept { return std::uncaught_exceptions() > uncaught_on_creation_; }
     constexpr bool call_when_construct_failed() const noexcept { return true; }
+    void           release() noexcept { uncaught_on_creation_ = INT_MAX; }
+};
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+
+// The following strategies observe an object bound by the caller, so that the
+// guard involves neither std::uncaught_exceptions() nor exceptions at all. The
+// object must outlive the guard. release() drops the pointer.
+
+// Calls when the bound error is set: bool(e), such as std::error_code or an
+// errno-like int.
+SCOPE_EXPORT template <typename E>
+class strategy_error
+{
+public:
+    strategy_error() = delete;
+    explicit strategy_error(const E& e) noexcept : error_{&e} {}
+
+    bool           call_when_dtor() const noexcept { return error_ && static_cast<bool>(*error_); }
+    constexpr bool call_when_construct_failed() const noexcept { return true; }
+    void           release() noexcept { error_ = nullptr; }
+
+private:
+    const E* error_;
+};
+
+// Calls when the bound flag is true, for example a `bool failed` set on every
+// early return.
+SCOPE_EXPORT class strategy_flag
+{
+public:
+    strategy_flag() = delete;
+    explicit strategy_flag(const bool& flag) noexcept : flag_{&flag} {}
+
+    bool           call_when_dtor() const noexcept { return flag_ && *flag_; }
+    constexpr bool call_when_construct_failed() const noexcept { return true; }
+    void           release() noexcept { flag_ = nullptr; }
+
+private:
+    const bool* flag_;
+};
+
+// Calls when cancellation was requested on the bound token: token.stop_requested(),
+// such as std::stop_token.
+SCOPE_EXPORT template <typename Token>
+class strategy_cancel
+{
+public:
+    strategy_cancel() = delete;
+    explicit strategy_cancel(const Token& token) noexcept : token_{&token} {}
+
+    bool           call_when_dtor() const noexcept { return token_ && token_->stop_requested(); }
+    constexpr bool call_when_construct_failed() const noexcept { return true; }
+    void           release() noexcept { token_ = nullptr; }
+
+private:
+    const Token* token_;
+};
+
+template <typename Strategy, typename = void>
+struct has_packed_flag : public std::false_type {};
+
+template <typename Strategy>
+struct has_packed_flag<Strategy, decltype(std::declval<Strategy&>().release(), void())> : public std::true_type {};
+
+// The armed flag and the strategy of a scope_guard. A strategy which provides
+// release() stores the flag itself, any other gets a separate bool.
+template <typename Strategy, bool = has_packed_flag<Strategy>::value>
+class guard_state : private compressed_storage<Strategy>
+{
+public:
+    explicit guard_state(Strategy s) noexcept
+        : compressed_storage<Strategy>{std::move(s)}
+    {}
+
+    bool call_when_dtor() const noexcept
+    {
+        return execute_on_destruction_ && this->get().call_when_dtor();
+    }
+
+    void release() noexcept
+    {
+        execute_on_destruction_ = false;
+    }
+
+private:
+    bool execute_on_destruction_{true};
+};
+
+template <typename Strategy>
+class guard_state<Strategy, true>
+{
+public:
+    explicit guard_state(Strategy s) noexcept
+        : strategy_(std::move(s))
+    {}
+
+    bool call_when_dtor() const noexcept
+    {
+        return strategy_.call_when_dtor();
+    }
+
+    void release() noexcept
+    {
+        strategy_.release();
+    }
+
+private:
+    Strategy strategy_;
 };
+
+template <typename Strategy>
+struct guard_kind_of : public std::integral_constant<guard_kind, guard_kind::scope_guard> {};
+
+template <>
+struct guard_kind_of<strategy_exit> : public std::integral_constant<guard_kind, guard_kind::scope_exit> {};
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+template <>
+struct guard_kind_of<strategy_fail> : public std::integral_constant<guard_kind, guard_kind::scope_fail> {};
+
+template <>
+struct guard_kind_of<strategy_success> : public std::integral_constant<guard_kind, guard_kind::scope_success> {};
 #endif // defined(SCOPE_USE_SUCCESS_FAIL)
 
 template <typename EF, typename Strategy>
 struct is_dtor_noexcept_t : public std::true_type {};
 
-#if defined(SCOPE_USE_SUCCESS_FAIL)
+#if defined(SCOPE_NO_EXCEPTIONS)
+using has_exceptions = std::false_type;
+#else
+using has_exceptions = std::true_type;
+#endif
+
+#if defined(SCOPE_USE_SUCCESS_FAIL) && !defined(SCOPE_NO_EXCEPTIONS)
 template <typename EF>
 struct is_dtor_noexcept_t<EF, strategy_success>
     : public conditional_t<noexcept(std::declval<EF>()()), std::true_type, std::false_type>
 {};
 #endif // defined(SCOPE_USE_SUCCESS_FAIL)
 
-template <typename EF, typename Strategy>
-class scope_guard
+template <typename T, typename U>
+constexpr
+conditional_t<std::is_nothrow_constructible<T, U>::value, U&&, const U&>
+forward_if_nothrow_constructible(U&& value)
+{
+    return std::forward<U>(value);
+}
+
+template <typename T, typename U>
+constexpr
+conditional_t<std::is_nothrow_assignable<T&, U>::value, U&&, const U&>
+forward_if_nothrow_assignable(U&& value)
+{
+    return std::forward<U>(value);
+}
+
+template <typename T, typename U>
+conditional_t<std::is_nothrow_move_assignable<T>::value, U&&, const U&>
+forward_if_nothrow_move_assignable(U& value) noexcept
+{
+    return std::move(value);
+}
+
+SCOPE_EXPORT template <typename EF, typename Strategy>
+class scope_guard : private compressed_storage<EF>
 {
+    static_assert(std::is_nothrow_move_constructible<Strategy>::value && std::is_nothrow_copy_constructible<Strategy>::value,
+                  "the Strategy of scope_guard must be nothrow copy and move constructible");
+
+    using storage_type = compressed_storage<EF>;
+
 public:
-    template <
-        typename EFP,
-        enable_if_t<std::is_constructible<EF, EFP>::value, std::nullptr_t> = nullptr,
-        enable_if_t<(!std::is_lvalue_reference<EFP>::value && std::is_nothrow_constructible<EF, EFP>::value), std::nullptr_t> = nullptr
-    >
-    explicit scope_guard(EFP&& f) noexcept
-        : exit_function_{std::forward<EFP>(f)}
-    {}
+    SCOPE_TEMPLATE((typename EFP),
+        std::is_constructible<EF, EFP>::value &&
+        (!std::is_lvalue_reference<EFP>::value && std::is_nothrow_constructible<EF, EFP>::value))
+    explicit scope_guard(EFP&& f, Strategy s = Strategy{} SCOPE_SITE_PARAM) noexcept
+        : storage_type{std::forward<EFP>(f)}
+        , state_{std::move(s)}
+    {
+        SCOPE_PROBE(probe_.created(site.file, site.line, guard_kind_of<Strategy>::value);)
+    }
 
-    template <
-        typename EFP,
-        enable_if_t<std::is_constructible<EF, EFP>::value, std::nullptr_t> = nullptr,
-        enable_if_t<!(!std::is_lvalue_reference<EFP>::value && std::is_nothrow_constructible<EF, EFP>::value), std::nullptr_t> = nullptr,
-        enable_if_t<std::is_nothrow_constructible<EF, EFP>::value || std::is_nothrow_constructible<EF, EFP&>::value, std::nullptr_t> = nullptr
-    >
-    explicit scope_guard(EFP&& f) noexcept
-        : exit_function_{f}
-    {}
+    SCOPE_TEMPLATE((typename EFP),
+        std::is_constructible<EF, EFP>::value &&
+        !(!std::is_lvalue_reference<EFP>::value && std::is_nothrow_constructible<EF, EFP>::value) &&
+        (std::is_nothrow_constructible<EF, EFP>::value || std::is_nothrow_constructible<EF, EFP&>::value || !has_exceptions::value))
+    explicit scope_guard(EFP&& f, Strategy s = Strategy{} SCOPE_SITE_PARAM) noexcept
+        : storage_type{f}
+        , state_{std::move(s)}
+    {
+        SCOPE_PROBE(probe_.created(site.file, site.line, guard_kind_of<Strategy>::value);)
+    }
 
-    template <
-        typename EFP,
-        enable_if_t<std::is_constructible<EF, EFP>::value, std::nullptr_t> = nullptr,
-        enable_if_t<!(!std::is_lvalue_reference<EFP>::value && std::is_nothrow_constructible<EF, EFP>::value), std::nullptr_t> = nullptr,
-        enable_if_t<!(std::is_nothrow_constructible<EF, EFP>::value || std::is_nothrow_constructible<EF, EFP&>::value), std::nullptr_t> = nullptr
-    >
-    explicit scope_guard(EFP&& f)
+#if !defined(SCOPE_NO_EXCEPTIONS)
+    SCOPE_TEMPLATE((typename EFP),
+        std::is_constructible<EF, EFP>::value &&
+        !(!std::is_lvalue_reference<EFP>::value && std::is_nothrow_constructible<EF, EFP>::value) &&
+        !(std::is_nothrow_constructible<EF, EFP>::value || std::is_nothrow_constructible<EF, EFP&>::value))
+    explicit scope_guard(EFP&& f, Strategy s = Strategy{} SCOPE_SITE_PARAM)
     try
-        : exit_function_{f}
-    {}
+        : storage_type{f}
+        , state_{s}
+    {
+        SCOPE_PROBE(probe_.created(site.file, site.line, guard_kind_of<Strategy>::value);)
+    }
     catch(...)
     {
-        if(Strategy().call_when_construct_failed()) {
+        const bool call = s.call_when_construct_failed();
+        SCOPE_USDT(guard_construct_failed, guard_kind_of<Strategy>::value, f, call);
+        if(call) {
             f();
         }
         throw;
     }
-
-    template <
-        typename EFP = EF,
-        enable_if_t<std::is_nothrow_move_constructible<EFP>::value, std::nullptr_t> = nullptr
-    >
-    scope_guard(scope_guard&& rhs) noexcept
-        : execute_on_destruction_{rhs.execute_on_destruction_}
-        , strategy_{rhs.strategy_}
-        , exit_function_{std::forward<EF>(rhs.exit_function_)}
-    {
-        rhs.release();
-    }
-
-    template <
-        typename EFP = EF,
-        enable_if_t<!std::is_nothrow_move_constructible<EFP>::value, std::nullptr_t> = nullptr,
-        enable_if_t<std::is_copy_constructible<EFP>::value, std::nullptr_t> = nullptr
-    >
-    scope_guard(scope_guard&& rhs) noexcept(std::is_nothrow_copy_constructible<EF>::value)
-        : execute_on_destruction_{rhs.execute_on_destruction_}
-        , strategy_{rhs.strategy_}
-        , exit_function_{rhs.exit_function_}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+    // Moves the exit function if that can not throw, and copies it otherwise.
+    SCOPE_TEMPLATE((typename EFP = EF),
+        std::is_nothrow_move_constructible<EFP>::value || std::is_copy_constructible<EFP>::value)
+    scope_guard(scope_guard&& rhs) noexcept(std::is_nothrow_move_constructible<EF>::value || std::is_nothrow_copy_constructible<EF>::value)
+        : storage_type{forward_if_nothrow_constructible<EF>(std::forward<EF>(rhs.exit_function()))}
+        , state_{rhs.state_}
+        SCOPE_PROBE(, probe_{rhs.probe_})
     {
-        rhs.release();
+        rhs.state_.release();
     }
 
     ~scope_guard() noexcept(is_dtor_noexcept_t<EF, Strategy>::value)
     {
-        if(execute_on_destruction_ && strategy_.call_when_dtor()) {
-            exit_function_();
+        const bool call = state_.call_when_dtor();
+        SCOPE_USDT(guard_exit, guard_kind_of<Strategy>::value, exit_function(), call);
+        if(call) {
+            SCOPE_PROBE(probe_.fired(unwinding());)
+            exit_function()();
         }
     }
 
     void release() noexcept
     {
-        execute_on_destruction_ = false;
+        SCOPE_PROBE(probe_.released();)
+        state_.release();
     }
 
     scope_guard(const scope_guard&) = delete;
@@ -194,96 +714,194 @@ public:
     scope_guard& operator=(scope_guard&&) = delete;
 
 private:
-    bool execute_on_destruction_{true};
-    Strategy strategy_{};
-    EF exit_function_;
+    EF& exit_function() noexcept { return storage_type::get(); }
+
+    guard_state<Strategy> state_;
+    SCOPE_PROBE(instrumentation_detail::guard_probe probe_;)
 };
 
-template <typename EF>
+#if defined(SCOPE_USE_DEDUCTION_GUIDE)
+SCOPE_EXPORT template <class EF, class Strategy>
+scope_guard(EF, Strategy) -> scope_guard<EF, Strategy>;
+#endif // defined(SCOPE_USE_DEDUCTION_GUIDE)
+
+SCOPE_EXPORT template <typename EF>
 class scope_exit : public scope_guard<EF, strategy_exit>
 {
     using base_type = enable_if_t<!std::is_same<detail::remove_cvref_t<EF>, scope_exit>::value, scope_guard<EF, strategy_exit>>;
 public:
+#if defined(SCOPE_ENABLE_INSTRUMENTATION)
+    // An inherited constructor would take the site of the using declaration.
+    SCOPE_TEMPLATE((typename EFP), std::is_constructible<base_type, EFP, strategy_exit, guard_site>::value)
+    explicit scope_exit(EFP&& f SCOPE_SITE_PARAM) noexcept(std::is_nothrow_constructible<base_type, EFP, strategy_exit, guard_site>::value)
+        : base_type(std::forward<EFP>(f), strategy_exit{}, site)
+    {}
+#else
     using base_type::base_type;
+#endif // defined(SCOPE_ENABLE_INSTRUMENTATION)
 };
 
 #if defined(SCOPE_USE_DEDUCTION_GUIDE)
-template <class EF>
+SCOPE_EXPORT template <class EF>
 scope_exit(EF) -> scope_exit<EF>;
 #endif // defined(SCOPE_USE_DEDUCTION_GUIDE)
 
 #if defined(SCOPE_USE_SUCCESS_FAIL)
 
-template <typename EF>
+SCOPE_EXPORT template <typename EF>
 class scope_fail : public scope_guard<EF, strategy_fail>
 {
     using base_type = enable_if_t<!std::is_same<detail::remove_cvref_t<EF>, scope_fail>::value, scope_guard<EF, strategy_fail>>;
 public:
+#if defined(SCOPE_ENABLE_INSTRUMENTATION)
+    SCOPE_TEMPLATE((typename EFP), std::is_constructible<base_type, EFP, strategy_fail, guard_site>::value)
+    explicit scope_fail(EFP&& f SCOPE_SITE_PARAM) noexcept(std::is_nothrow_constructible<base_type, EFP, strategy_fail, guard_site>::value)
+        : base_type(std::forward<EFP>(f), strategy_fail{}, site)
+    {}
+#else
     using base_type::base_type;
+#endif // defined(SCOPE_ENABLE_INSTRUMENTATION)
 };
 
 #if defined(SCOPE_USE_DEDUCTION_GUIDE)
-template <class EF>
+SCOPE_EXPORT template <class EF>
 scope_fail(EF) -> scope_fail<EF>;
 #endif // defined(SCOPE_USE_DEDUCTION_GUIDE)
 
-template <typename EF>
+SCOPE_EXPORT template <typename EF>
 class scope_success : public scope_guard<EF, strategy_success>
 {
     using base_type = enable_if_t<!std::is_same<detail::remove_cvref_t<EF>, scope_success>::value, scope_guard<EF, strategy_success>>;
 public:
+#if defined(SCOPE_ENABLE_INSTRUMENTATION)
+    SCOPE_TEMPLATE((typename EFP), std::is_constructible<base_type, EFP, strategy_success, guard_site>::value)
+    explicit scope_success(EFP&& f SCOPE_SITE_PARAM) noexcept(std::is_nothrow_constructible<base_type, EFP, strategy_success, guard_site>::value)
+        : base_type(std::forward<EFP>(f), strategy_success{}, site)
+    {}
+#else
     using base_type::base_type;
+#endif // defined(SCOPE_ENABLE_INSTRUMENTATION)
 };
 
 #if defined(SCOPE_USE_DEDUCTION_GUIDE)
-template <class EF>
+SCOPE_EXPORT template <class EF>
 scope_success(EF) -> scope_success<EF>;
 #endif // defined(SCOPE_USE_DEDUCTION_GUIDE)
 
 #endif // defined(SCOPE_USE_SUCCESS_FAIL)
 
 template <class EF>
-scope_exit<EF> make_scope_exit(EF&& f)
+scope_exit<EF> make_scope_exit(EF&& f SCOPE_SITE_PARAM)
+{
+    return scope_exit<EF>(std::forward<EF>(f) SCOPE_SITE_ARG);
+}
+
+// The guards of the library itself, which the instrumentation does not count.
+template <class EF>
+scope_exit<EF> make_untracked_scope_exit(EF&& f)
 {
-    return scope_exit<EF>(std::forward<EF>(f));
+    return scope_exit<EF>(std::forward<EF>(f) SCOPE_PROBE(, guard_site{nullptr, 0}));
 }
 
 #if defined(SCOPE_USE_SUCCESS_FAIL)
 template <class EF>
-scope_fail<EF> make_scope_fail(EF&& f)
+scope_fail<EF> make_scope_fail(EF&& f SCOPE_SITE_PARAM)
 {
-    return scope_fail<EF>(std::forward<EF>(f));
+    return scope_fail<EF>(std::forward<EF>(f) SCOPE_SITE_ARG);
 }
 
 template <class EF>
-scope_success<EF> make_scope_success(EF&& f)
+scope_success<EF> make_scope_success(EF&& f SCOPE_SITE_PARAM)
 {
-    return scope_success<EF>(std::forward<EF>(f));
+    return scope_success<EF>(std::forward<EF>(f) SCOPE_SITE_ARG);
 }
 #endif // defined(SCOPE_USE_SUCCESS_FAIL)
 
-template <typename T, typename U>
-constexpr
-conditional_t<std::is_nothrow_constructible<T, U>::value, U&&, const U&>
-forward_if_nothrow_constructible(U&& value)
+template <class EF, class Strategy>
+scope_guard<EF, Strategy> make_scope_guard(EF&& f, Strategy s SCOPE_SITE_PARAM)
 {
-    return std::forward<U>(value);
+    return scope_guard<EF, Strategy>(std::forward<EF>(f), std::move(s) SCOPE_SITE_ARG);
+}
+
+// The guard keeps a pointer to the bound object: a temporary is rejected.
+template <class EF, class E>
+scope_guard<EF, strategy_error<E>> make_scope_error(EF&& f, const E& e SCOPE_SITE_PARAM)
+{
+    return scope_guard<EF, strategy_error<E>>(std::forward<EF>(f), strategy_error<E>{e} SCOPE_SITE_ARG);
+}
+
+template <class EF, class E>
+void make_scope_error(EF&&, const E&&) = delete;
+
+template <class EF>
+scope_guard<EF, strategy_flag> make_scope_flag(EF&& f, const bool& flag SCOPE_SITE_PARAM)
+{
+    return scope_guard<EF, strategy_flag>(std::forward<EF>(f), strategy_flag{flag} SCOPE_SITE_ARG);
+}
+
+template <class EF>
+void make_scope_flag(EF&&, const bool&&) = delete;
+
+template <class EF, class Token>
+scope_guard<EF, strategy_cancel<Token>> make_scope_cancel(EF&& f, const Token& token SCOPE_SITE_PARAM)
+{
+    return scope_guard<EF, strategy_cancel<Token>>(std::forward<EF>(f), strategy_cancel<Token>{token} SCOPE_SITE_ARG);
 }
 
+template <class EF, class Token>
+void make_scope_cancel(EF&&, const Token&&) = delete;
+
 struct empty_guard
 {
     void release() const noexcept {}
 };
 
-template <typename T>
-class resource_wrapper
+template <typename T, typename U>
+using forwarded_t = decltype(forward_if_nothrow_constructible<T, U>(std::declval<U>()));
+
+// The guard which calls f if the construction of the storage T from a U
+// throws. If it can not throw, the guard is an empty_guard, and there is
+// no scope_exit<F> to instantiate for each resource and deleter type.
+SCOPE_TEMPLATE((typename T, typename U, typename F), !std::is_nothrow_constructible<T, empty_guard, U>::value)
+scope_exit<F> make_construct_guard(F&& f)
 {
-public:
-    template <
-        typename Guard, typename TT,
-        enable_if_t<std::is_constructible<T, TT>::value, std::nullptr_t> = nullptr
-    >
-    resource_wrapper(Guard&& g, TT&& value) noexcept(std::is_nothrow_constructible<T, TT>::value)
+    return make_untracked_scope_exit(std::forward<F>(f));
+}
+
+SCOPE_TEMPLATE((typename T, typename U, typename F), std::is_nothrow_constructible<T, empty_guard, U>::value)
+empty_guard make_construct_guard(F&&) noexcept
+{
+    return {};
+}
+
+// std::reference_wrapper, without <functional>: the resource of a
+// unique_resource<T&, D>, which reset() rebinds.
+template <typename T>
+class reference_holder
+{
+public:
+    reference_holder(T& r) noexcept
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+        : ptr_{__builtin_addressof(r)}
+#else
+        : ptr_{&r}
+#endif
+    {}
+    reference_holder(T&&) = delete;
+
+    operator T&() const noexcept { return *ptr_; }
+    T& get() const noexcept { return *ptr_; }
+
+private:
+    T* ptr_;
+};
+
+template <typename T>
+class resource_wrapper
+{
+public:
+    SCOPE_TEMPLATE((typename Guard, typename TT), std::is_constructible<T, TT>::value)
+    resource_wrapper(Guard&& g, TT&& value) noexcept(std::is_nothrow_constructible<T, TT>::value)
         : value_(std::forward<TT>(value))
     {
         g.release();
@@ -313,153 +931,108 @@ private:
     T value_;
 };
 
-template <typename T>
-class resource_wrapper<T&>
-{
-public:
-    template <
-        typename Guard, typename TT,
-        enable_if_t<std::is_convertible<TT, T&>::value, std::nullptr_t> = nullptr
-    >
-    resource_wrapper(Guard&& g, TT&& value) noexcept(std::is_nothrow_constructible<T, TT&>::value)
-        : value_(static_cast<T&>(value))
-    {
-        g.release();
-    }
+struct deleter_tag {};
+struct policy_tag {};
 
-    T&       get() noexcept       { return value_.get(); }
-    const T& get() const noexcept { return value_.get(); }
-
-    void reset(const resource_wrapper& other) noexcept
-    {
-        value_ = other.value_;
-    }
-    void reset(resource_wrapper&& other) noexcept
-    {
-        value_ = std::move(other.value_);
-    }
-    void reset(const T& new_value) noexcept
-    {
-        value_ = std::ref(new_value);
-    }
-    void reset(T&& new_value) noexcept
-    {
-        value_ = std::ref(new_value);
-    }
+// The default policy of unique_resource, which does nothing. A policy is
+// told when the unique_resource takes ownership of a resource, by
+// on_acquire(r, d), and when it is about to call the deleter, by
+// on_reset(r, d). Both must be noexcept, and so must its default and move
+// constructors.
+SCOPE_EXPORT struct null_resource_policy
+{
+    template <typename R, typename D>
+    void on_acquire(const R&, const D&) noexcept {}
 
-private:
-    std::reference_wrapper<T> value_;
+    template <typename R, typename D>
+    void on_reset(const R&, const D&) noexcept {}
 };
 
-template <typename R, typename D>
+// The policy, the resource and the deleter are base classes so that an
+// empty deleter or policy takes no space. The policy comes first so that its
+// state, usually a timestamp, does not add padding after a small resource.
+// The resource base is listed before the deleter: it is initialized first,
+// as P0052 requires.
+SCOPE_EXPORT template <typename R, typename D, typename Policy = null_resource_policy>
 class unique_resource
+    : private compressed_storage<Policy, policy_tag>
+    , private resource_wrapper<conditional_t<std::is_reference<R>::value, reference_holder<remove_reference_t<R>>, R>>
+    , private compressed_storage<D, deleter_tag>
 {
-    using R1 = conditional_t<std::is_reference<R>::value, std::reference_wrapper<remove_reference_t<R>>, R>;
+    using R1 = conditional_t<std::is_reference<R>::value, reference_holder<remove_reference_t<R>>, R>;
+    using resource_type = resource_wrapper<R1>;
+    using deleter_type = compressed_storage<D, deleter_tag>;
+    using policy_type = compressed_storage<Policy, policy_tag>;
 
 public:
-    template <
-        typename RR, typename DD,
-        enable_if_t<std::is_constructible<R1, RR>::value, std::nullptr_t> = nullptr,
-        enable_if_t<std::is_constructible<D , DD>::value, std::nullptr_t> = nullptr,
-        enable_if_t<(std::is_nothrow_constructible<R1, RR>::value || std::is_constructible<R1, RR&>::value), std::nullptr_t> = nullptr,
-        enable_if_t<(std::is_nothrow_constructible<D , DD>::value || std::is_constructible<D , DD&>::value), std::nullptr_t> = nullptr
-    >
-    unique_resource(RR&& r, DD&& d, bool e)
+    SCOPE_TEMPLATE((typename RR, typename DD),
+        std::is_constructible<R1, RR>::value && std::is_constructible<D , DD>::value &&
+        (std::is_nothrow_constructible<R1, RR>::value || std::is_constructible<R1, RR&>::value) &&
+        (std::is_nothrow_constructible<D , DD>::value || std::is_constructible<D , DD&>::value))
+    unique_resource(RR&& r, DD&& d, bool e SCOPE_RESOURCE_SITE_PARAM)
             noexcept((std::is_nothrow_constructible<R1, RR>::value || std::is_nothrow_constructible<R1, RR&>::value) &&
                      (std::is_nothrow_constructible<D , DD>::value || std::is_nothrow_constructible<D , DD&>::value))
-        : resource_{make_scope_exit([&r, &d, &e]{ if(e) d(r); }), forward_if_nothrow_constructible<R, RR>(std::forward<RR>(r))}
-        , deleter_{make_scope_exit([this, &d, &e]{ if(e) d(get()); }), forward_if_nothrow_constructible<D, DD>(std::forward<DD>(d))}
+        : policy_type{Policy{}}
+        , resource_type{make_construct_guard<resource_type, forwarded_t<R, RR>>([&r, &d, &e]{ if(e) d(r); }), forward_if_nothrow_constructible<R, RR>(std::forward<RR>(r))}
+        , deleter_type{make_construct_guard<deleter_type, forwarded_t<D, DD>>([this, &d, &e]{ if(e) d(get()); }), forward_if_nothrow_constructible<D, DD>(std::forward<DD>(d))}
         , execute_on_reset_{e}
-    {}
+    {
+        if(e) {
+            policy().on_acquire(get(), get_deleter());
+        }
+        SCOPE_PROBE(if(e) probe_.created(site.file, site.line, guard_kind::unique_resource);)
+        SCOPE_LIVE(if(e) live_.join(site.file, site.line, get());)
+    }
 
     unique_resource()
-        : resource_{empty_guard{}, R{}}
-        , deleter_{empty_guard{}, D{}}
+        : policy_type{Policy{}}
+        , resource_type{empty_guard{}, R{}}
+        , deleter_type{empty_guard{}, D{}}
         , execute_on_reset_{false}
     {};
 
-    template <
-        typename RR, typename DD,
-        enable_if_t<std::is_constructible<R1, RR>::value, std::nullptr_t> = nullptr,
-        enable_if_t<std::is_constructible<D , DD>::value, std::nullptr_t> = nullptr,
-        enable_if_t<(std::is_nothrow_constructible<R1, RR>::value || std::is_constructible<R1, RR&>::value), std::nullptr_t> = nullptr,
-        enable_if_t<(std::is_nothrow_constructible<D , DD>::value || std::is_constructible<D , DD&>::value), std::nullptr_t> = nullptr
-    >
-    unique_resource(RR&& r, DD&& d) noexcept((std::is_nothrow_constructible<R1, RR>::value || std::is_nothrow_constructible<R1, RR&>::value) &&
+    SCOPE_TEMPLATE((typename RR, typename DD),
+        std::is_constructible<R1, RR>::value && std::is_constructible<D , DD>::value &&
+        (std::is_nothrow_constructible<R1, RR>::value || std::is_constructible<R1, RR&>::value) &&
+        (std::is_nothrow_constructible<D , DD>::value || std::is_constructible<D , DD&>::value))
+    unique_resource(RR&& r, DD&& d SCOPE_RESOURCE_SITE_PARAM) noexcept((std::is_nothrow_constructible<R1, RR>::value || std::is_nothrow_constructible<R1, RR&>::value) &&
                                              (std::is_nothrow_constructible<D , DD>::value || std::is_nothrow_constructible<D , DD&>::value))
-        : resource_{make_scope_exit([&r, &d]{ d(r); }), forward_if_nothrow_constructible<R, RR>(std::forward<RR>(r))}
-        , deleter_{make_scope_exit([this, &d]{ d(get()); }), forward_if_nothrow_constructible<D, DD>(std::forward<DD>(d))}
+        : unique_resource(std::forward<RR>(r), std::forward<DD>(d), true SCOPE_RESOURCE_SITE_ARG)
     {}
 
     unique_resource(const unique_resource&) = delete;
     unique_resource& operator=(const unique_resource&) = delete;
 
     unique_resource(unique_resource&& rhs) noexcept(std::is_nothrow_move_constructible<R1>::value && std::is_nothrow_move_constructible<D>::value)
-        : resource_{empty_guard{}, std::move_if_noexcept(rhs.get())}
-        , deleter_{make_scope_exit([&rhs]{ rhs.reset(); }), std::move_if_noexcept(rhs.deleter_.get())}
+        : policy_type{std::move(rhs.policy())}
+        , resource_type{empty_guard{}, std::move_if_noexcept(rhs.get())}
+        , deleter_type{make_construct_guard<deleter_type, decltype(std::move_if_noexcept(rhs.deleter()))>([&rhs]{ rhs.reset(); }), std::move_if_noexcept(rhs.deleter())}
         , execute_on_reset_{exchange(rhs.execute_on_reset_, false)}
+        SCOPE_PROBE(, probe_{rhs.probe_})
+        SCOPE_LIVE(, live_{std::move(rhs.live_)})
     {}
 
-    template <
-        typename RR1 = R1, typename DD = D,
-        enable_if_t<std::is_nothrow_move_assignable<RR1>::value, std::nullptr_t> = nullptr,
-        enable_if_t<std::is_nothrow_move_assignable<DD>::value, std::nullptr_t> = nullptr
-    >
-    unique_resource& operator=(unique_resource&& rhs) noexcept
-    {
-        if(this != &rhs) {
-            reset();
-            resource_.reset(std::move(rhs.resource_));
-            deleter_.reset(std::move(rhs.deleter_));
-            execute_on_reset_ = exchange(rhs.execute_on_reset_, false);
-        }
-        return *this;
-    }
-
-    template <
-        typename RR1 = R1, typename DD = D,
-        enable_if_t<std::is_nothrow_move_assignable<RR1>::value, std::nullptr_t> = nullptr,
-        enable_if_t<!std::is_nothrow_move_assignable<DD>::value, std::nullptr_t> = nullptr
-    >
-    unique_resource& operator=(unique_resource&& rhs)
-    {
-        if(this != &rhs) {
-            reset();
-            deleter_.reset(rhs.deleter_);
-            resource_.reset(std::move(rhs.resource_));
-            execute_on_reset_ = exchange(rhs.execute_on_reset_, false);
-        }
-        return *this;
-    }
-
-    template <
-        typename RR1 = R1, typename DD = D,
-        enable_if_t<!std::is_nothrow_move_assignable<RR1>::value, std::nullptr_t> = nullptr,
-        enable_if_t<std::is_nothrow_move_assignable<DD>::value, std::nullptr_t> = nullptr
-    >
+    // One body for every combination of nothrow move assignable resource and
+    // deleter: a throwing move is replaced by a copy, and a deleter which may
+    // throw is assigned before the resource is taken, so that rhs still owns
+    // the resource if the assignment throws.
     unique_resource& operator=(unique_resource&& rhs)
+            noexcept(std::is_nothrow_move_assignable<R1>::value && std::is_nothrow_move_assignable<D>::value)
     {
         if(this != &rhs) {
             reset();
-            resource_.reset(rhs.resource_);
-            deleter_.reset(std::move(rhs.deleter_));
-            execute_on_reset_ = exchange(rhs.execute_on_reset_, false);
-        }
-        return *this;
-    }
-
-    template <
-        typename RR1 = R1, typename DD = D,
-        enable_if_t<!std::is_nothrow_move_assignable<RR1>::value, std::nullptr_t> = nullptr,
-        enable_if_t<!std::is_nothrow_move_assignable<DD>::value, std::nullptr_t> = nullptr
-    >
-    unique_resource& operator=(unique_resource&& rhs)
-    {
-        if(this != &rhs) {
-            reset();
-            resource_.reset(rhs.resource_);
-            deleter_.reset(rhs.deleter_);
+            if(std::is_nothrow_move_assignable<D>::value) {
+                resource().reset(forward_if_nothrow_move_assignable<R1>(rhs.resource()));
+                deleter() = forward_if_nothrow_move_assignable<D>(rhs.deleter());
+            }
+            else {
+                deleter() = forward_if_nothrow_move_assignable<D>(rhs.deleter());
+                resource().reset(forward_if_nothrow_move_assignable<R1>(rhs.resource()));
+            }
+            policy() = std::move(rhs.policy());
             execute_on_reset_ = exchange(rhs.execute_on_reset_, false);
+            SCOPE_PROBE(probe_ = rhs.probe_;)
+            SCOPE_LIVE(live_ = std::move(rhs.live_);)
         }
         return *this;
     }
@@ -471,49 +1044,48 @@ public:
 
     void reset() noexcept
     {
+        SCOPE_USDT(resource_reset, guard_kind::unique_resource, get_deleter(), execute_on_reset_);
         if(execute_on_reset_) {
             execute_on_reset_ = false;
+            SCOPE_PROBE(probe_.fired(unwinding());)
+            SCOPE_LIVE(live_.leave();)
+            policy().on_reset(get(), get_deleter());
             get_deleter()(get());
         }
     }
 
-    template <typename RR, enable_if_t<std::is_nothrow_assignable<R1&, RR>::value, std::nullptr_t> = nullptr>
-    void reset(RR&& r)
-    {
-        reset();
-        resource_.reset(std::forward<RR>(r));
-        execute_on_reset_ = true;
-    }
-
-    template <typename RR, enable_if_t<!std::is_nothrow_assignable<R1&, RR>::value, std::nullptr_t> = nullptr>
-    void reset(RR&& r)
+    template <typename RR>
+    void reset(RR&& r SCOPE_RESOURCE_SITE_PARAM)
     {
         reset();
-        resource_.reset(as_const(r));
+        resource().reset(forward_if_nothrow_assignable<R1>(std::forward<RR>(r)));
         execute_on_reset_ = true;
+        policy().on_acquire(get(), get_deleter());
+        SCOPE_PROBE(probe_.created(site.file, site.line, guard_kind::unique_resource);)
+        SCOPE_LIVE(live_.join(site.file, site.line, get());)
     }
 
     void release() noexcept
     {
+        SCOPE_USDT(resource_release, guard_kind::unique_resource, get_deleter(), execute_on_reset_);
+        SCOPE_PROBE(if(execute_on_reset_) probe_.released();)
+        SCOPE_LIVE(live_.leave();)
         execute_on_reset_ = false;
     }
 
     const R& get() const noexcept
     {
-        return resource_.get();
+        return resource().get();
     }
 
-    template <
-        typename RR = R,
-        enable_if_t<std::is_pointer<RR>::value, std::nullptr_t> = nullptr,
-        enable_if_t<!std::is_void<typename std::remove_pointer<RR>::type>::value, std::nullptr_t> = nullptr
-    >
+    SCOPE_TEMPLATE((typename RR = R),
+        std::is_pointer<RR>::value && !std::is_void<typename std::remove_pointer<RR>::type>::value)
     typename std::add_lvalue_reference<typename std::remove_pointer<RR>::type>::type operator*() const noexcept
     {
         return *get();
     }
 
-    template <typename RR = R, enable_if_t<std::is_pointer<RR>::value, std::nullptr_t> = nullptr>
+    SCOPE_TEMPLATE((typename RR = R), std::is_pointer<RR>::value)
     RR operator->() const noexcept
     {
         return get();
@@ -521,54 +1093,1139 @@ public:
 
     const D& get_deleter() const noexcept
     {
-        return deleter_.get();
+        return deleter_type::get();
     }
 
 private:
-    resource_wrapper<R1> resource_;
-    resource_wrapper<D> deleter_;
+    resource_type&       resource() noexcept       { return *this; }
+    const resource_type& resource() const noexcept { return *this; }
+    D&                   deleter() noexcept        { return deleter_type::get(); }
+    Policy&              policy() noexcept         { return policy_type::get(); }
+
     bool execute_on_reset_{true};
+    SCOPE_PROBE(instrumentation_detail::guard_probe probe_;)
+    SCOPE_LIVE(live_detail::live_entry live_;)
 };
 
 #if defined(SCOPE_USE_DEDUCTION_GUIDE)
-template <typename R, typename D>
+SCOPE_EXPORT template <typename R, typename D>
 unique_resource(R, D) -> unique_resource<R, D>;
 #endif // defined(SCOPE_USE_DEDUCTION_GUIDE)
 
 template <typename R, typename D>
 unique_resource<decay_t<R>, decay_t<D>>
-make_unique_resource(R&& r, D&& d)
+make_unique_resource(R&& r, D&& d SCOPE_RESOURCE_SITE_PARAM)
         noexcept(std::is_nothrow_constructible<decay_t<R>, R>::value && std::is_nothrow_constructible<decay_t<D>, D>::value)
 {
-    unique_resource<decay_t<R>, decay_t<D>> ur{std::forward<R>(r), std::forward<D>(d)};
+    unique_resource<decay_t<R>, decay_t<D>> ur{std::forward<R>(r), std::forward<D>(d) SCOPE_RESOURCE_SITE_ARG};
     return ur;
 }
 
 template <typename R, typename D, typename S = decay_t<R>>
 unique_resource<decay_t<R>, decay_t<D>>
-make_unique_resource_checked(R&& resource, const S& invalid, D&& d)
+make_unique_resource_checked(R&& resource, const S& invalid, D&& d SCOPE_RESOURCE_SITE_PARAM)
         noexcept(std::is_nothrow_constructible<decay_t<R>, R>::value && std::is_nothrow_constructible<decay_t<D>, D>::value)
 {
-    unique_resource<decay_t<R>, decay_t<D>> ur{std::forward<R>(resource), std::forward<D>(d), !bool(resource == invalid)};
+    unique_resource<decay_t<R>, decay_t<D>> ur{std::forward<R>(resource), std::forward<D>(d), !bool(resource == invalid) SCOPE_RESOURCE_SITE_ARG};
     return ur;
 }
 
+// Operations on an exit function stored in a callback_slot. kind is a tag
+// chosen by the owner of the slot.
+struct callback_ops
+{
+    void (*invoke)(void* p);
+    void (*relocate)(void* dst, void* src) noexcept;
+    void (*destroy)(void* p) noexcept;
+    int kind;
+};
+
+// One type-erased exit function. A small, nothrow movable exit function is
+// stored in place, any other one on the heap.
+struct callback_slot
+{
+    const callback_ops* ops;
+    void* storage[3];
+};
+
+// The callback_ops of Traits, constant initialized.
+template <typename Traits, int Kind, bool TriviallyDestructible>
+struct callback_ops_for
+{
+    static const callback_ops value;
+};
+
+template <typename Traits, int Kind, bool TriviallyDestructible>
+const callback_ops callback_ops_for<Traits, Kind, TriviallyDestructible>::value = {
+    &Traits::invoke, &Traits::relocate, TriviallyDestructible ? nullptr : &Traits::destroy, Kind
+};
+
+template <typename F>
+struct is_inline_callback
+    : public std::integral_constant<bool,
+        sizeof(F) <= sizeof(callback_slot::storage) &&
+        alignof(F) <= alignof(void*) &&
+        std::is_nothrow_move_constructible<F>::value>
+{};
+
+template <typename F, bool = is_inline_callback<F>::value>
+struct callback_traits
+{
+    static F& get(void* p) noexcept { return *static_cast<F*>(p); }
+
+    template <typename FF>
+    static void construct(void* p, FF&& f)
+    {
+        ::new(p) F(std::forward<FF>(f));
+    }
+
+    static void invoke(void* p) { get(p)(); }
+
+    static void relocate(void* dst, void* src) noexcept
+    {
+        ::new(dst) F(std::move(get(src)));
+        get(src).~F();
+    }
+
+    static void destroy(void* p) noexcept { get(p).~F(); }
+
+    // destroy is null if there is nothing to do.
+    template <int Kind>
+    static const callback_ops* ops() noexcept
+    {
+        return &callback_ops_for<callback_traits, Kind, std::is_trivially_destructible<F>::value>::value;
+    }
+};
+
+template <typename F>
+struct callback_traits<F, false>
+{
+    static F& get(void* p) noexcept { return **static_cast<F**>(p); }
+
+    template <typename FF>
+    static void construct(void* p, FF&& f)
+    {
+        *static_cast<F**>(p) = new F(std::forward<FF>(f));
+    }
+
+    static void invoke(void* p) { get(p)(); }
+
+    static void relocate(void* dst, void* src) noexcept
+    {
+        *static_cast<F**>(dst) = *static_cast<F**>(src);
+    }
+
+    static void destroy(void* p) noexcept { delete *static_cast<F**>(p); }
+
+    template <int Kind>
+    static const callback_ops* ops() noexcept
+    {
+        return &callback_ops_for<callback_traits, Kind, false>::value;
+    }
+};
+
+// Type-erased exit functions in registration order. The first N slots are
+// stored in the object itself, the slots move to the heap beyond that.
+template <std::size_t N>
+class callback_stack
+{
+    static_assert(N > 0, "N must be greater than 0");
+
+public:
+    using handle = std::size_t;
+
+    callback_stack() noexcept = default;
+
+    callback_stack(const callback_stack&) = delete;
+    callback_stack& operator=(const callback_stack&) = delete;
+
+    ~callback_stack()
+    {
+        clear();
+        if(slots_ != inline_slots_) {
+            ::operator delete(slots_);
+        }
+    }
+
+    // Stores f tagged with Kind. f is left untouched if this throws.
+    template <int Kind, typename EFP>
+    handle push(EFP&& f)
+    {
+        using EF = decay_t<EFP>;
+        if(used_ == capacity_) {
+            grow();
+        }
+        callback_slot& slot = slots_[used_];
+        callback_traits<EF>::construct(slot.storage, forward_if_nothrow_constructible<EF, EFP>(std::forward<EFP>(f)));
+        slot.ops = callback_traits<EF>::template ops<Kind>();
+        ++size_;
+        return used_++;
+    }
+
+    void release(handle h) noexcept
+    {
+        if(h >= used_) {
+            return;
+        }
+        callback_slot& slot = slots_[h];
+        if(slot.ops) {
+            destroy(slot);
+            slot.ops = nullptr;
+            --size_;
+        }
+        while(used_ > 0 && !slots_[used_ - 1].ops) {
+            --used_;
+        }
+    }
+
+    // Calls the exit functions for which call(kind) holds in reverse order,
+    // and drops all of them.
+    template <typename Pred>
+    void run(Pred call)
+    {
+        while(used_ > 0) {
+            callback_slot& slot = slots_[--used_];
+            if(slot.ops) {
+                // The slot is dropped even if the exit function throws.
+                auto drop = make_untracked_scope_exit([this, &slot]{
+                    destroy(slot);
+                    --size_;
+                });
+                if(call(slot.ops->kind)) {
+                    slot.ops->invoke(slot.storage);
+                }
+            }
+        }
+    }
+
+    void clear() noexcept
+    {
+        while(used_ > 0) {
+            callback_slot& slot = slots_[--used_];
+            if(slot.ops) {
+                destroy(slot);
+            }
+        }
+        size_ = 0;
+    }
+
+    std::size_t size() const noexcept { return size_; }
+
+private:
+    static void destroy(callback_slot& slot) noexcept
+    {
+        if(slot.ops->destroy) {
+            slot.ops->destroy(slot.storage);
+        }
+    }
+
+    void grow()
+    {
+        std::size_t capacity = capacity_ * 2;
+        callback_slot* slots = static_cast<callback_slot*>(::operator new(sizeof(callback_slot) * capacity));
+        for(std::size_t i = 0; i < used_; ++i) {
+            slots[i].ops = slots_[i].ops;
+            if(slots[i].ops) {
+                slots[i].ops->relocate(slots[i].storage, slots_[i].storage);
+            }
+        }
+        if(slots_ != inline_slots_) {
+            ::operator delete(slots_);
+        }
+        slots_ = slots;
+        capacity_ = capacity;
+    }
+
+    std::size_t size_{0};
+    std::size_t used_{0};
+    std::size_t capacity_{N};
+    callback_slot* slots_{inline_slots_};
+    callback_slot inline_slots_[N];
+};
+
+// The destructor of a scope stack lets an exception of an exit function
+// escape only where the guard would: scope_success_stack, whose exit
+// functions are called when no exception is in flight. The other stacks
+// terminate, as the destructors of scope_exit and scope_fail do.
+template <typename Strategy>
+struct is_stack_dtor_noexcept : public std::true_type {};
+
+#if defined(SCOPE_USE_SUCCESS_FAIL) && !defined(SCOPE_NO_EXCEPTIONS)
+template <>
+struct is_stack_dtor_noexcept<strategy_success> : public std::false_type {};
+#endif // defined(SCOPE_USE_SUCCESS_FAIL) && !defined(SCOPE_NO_EXCEPTIONS)
+
+// A stack of exit functions registered at run time, called in reverse order
+// of registration when the stack is destroyed and Strategy allows it, like
+// a scope_guard for each of them. Strategy is evaluated once for the whole
+// stack. The first N exit functions are stored in the object itself, the
+// stack moves to the heap beyond that.
+template <typename Strategy, std::size_t N>
+class basic_scope_stack
+{
+public:
+    using handle = typename callback_stack<N>::handle;
+
+    basic_scope_stack() noexcept = default;
+
+    // If an exit function throws, the exit functions below it are dropped
+    // without being called.
+    ~basic_scope_stack() noexcept(is_stack_dtor_noexcept<Strategy>::value)
+    {
+        if(strategy_.get().call_when_dtor()) {
+            callbacks_.run([](int){ return true; });
+        }
+    }
+
+    // Registers f and returns a handle for release(handle). If f can not be
+    // stored, calls f() when Strategy calls exit functions on construction
+    // failure, and rethrows.
+    template <typename EFP>
+    handle push(EFP&& f)
+    {
+        SCOPE_TRY {
+            return callbacks_.template push<0>(std::forward<EFP>(f));
+        }
+        SCOPE_CATCH_ALL {
+            if(Strategy().call_when_construct_failed()) {
+                f();
+            }
+            SCOPE_RETHROW;
+        }
+    }
+
+    // Drops the exit function registered as h without calling it. h must
+    // not be used again once released.
+    void release(handle h) noexcept
+    {
+        callbacks_.release(h);
+    }
+
+    // Drops all exit functions without calling them.
+    void release() noexcept
+    {
+        callbacks_.clear();
+    }
+
+    std::size_t size() const noexcept { return callbacks_.size(); }
+    bool empty() const noexcept { return callbacks_.size() == 0; }
+
+private:
+    compressed_storage<Strategy> strategy_{Strategy{}};
+    callback_stack<N> callbacks_;
+};
+
+template <std::size_t N = 8>
+class scope_exit_stack : public basic_scope_stack<strategy_exit, N> {};
+
+// The exit functions deferred by scope_defer on the calling thread. They are
+// called in order of deferral, in batches: when the ring is full, on
+// defer_flush() and when the thread exits. Deferred exit functions must not
+// throw: they run far from the scope which deferred them, where nothing
+// could handle the exception.
+class defer_queue
+{
+public:
+    static constexpr std::size_t capacity = 64;
+
+    // The queue of the calling thread, or nullptr once it is destroyed at
+    // thread exit.
+    static defer_queue* local() noexcept
+    {
+        if(destroyed()) {
+            return nullptr;
+        }
+        static thread_local defer_queue q;
+        return &q;
+    }
+
+    defer_queue() noexcept = default;
+
+    defer_queue(const defer_queue&) = delete;
+    defer_queue& operator=(const defer_queue&) = delete;
+
+    ~defer_queue()
+    {
+        flush();
+        destroyed() = true;
+    }
+
+    template <typename EF>
+    void push(EF&& f)
+    {
+        static_assert(is_inline_callback<decay_t<EF>>::value, "EF must be stored in place");
+        using F = decay_t<EF>;
+        if(size() == capacity) {
+            if(flushing_) {
+                f();
+                return;
+            }
+            flush();
+        }
+        callback_slot& slot = slots_[tail_ % capacity];
+        callback_traits<F>::construct(slot.storage, std::move(f));
+        slot.ops = callback_traits<F>::template ops<0>();
+        ++tail_;
+    }
+
+    // Calls the deferred exit functions. Exit functions deferred meanwhile
+    // are called too; a call from a deferred exit function does nothing.
+    void flush()
+    {
+        if(flushing_) {
+            return;
+        }
+        flushing_ = true;
+        auto done = make_untracked_scope_exit([this]{ flushing_ = false; });
+        while(head_ != tail_) {
+            callback_slot& slot = slots_[head_ % capacity];
+            // The slot stays in the ring while it runs: the exit function
+            // may defer another one.
+            auto pop = make_untracked_scope_exit([this, &slot]{
+                if(slot.ops->destroy) {
+                    slot.ops->destroy(slot.storage);
+                }
+                ++head_;
+            });
+            slot.ops->invoke(slot.storage);
+        }
+    }
+
+    std::size_t size() const noexcept { return tail_ - head_; }
+
+private:
+    // Trivially destructible, so that it can still be read after the queue
+    // of the thread is destroyed.
+    static bool& destroyed() noexcept
+    {
+        static thread_local bool d = false;
+        return d;
+    }
+
+    std::size_t head_{0};
+    std::size_t tail_{0};
+    bool flushing_{false};
+    callback_slot slots_[capacity];
+};
+
+template <typename EF>
+struct deferred_exit_function
+{
+    static_assert(is_inline_callback<EF>::value,
+        "the exit function of scope_defer must be nothrow movable and fit in 3 pointers: "
+        "capture a pointer to larger state");
+
+    EF f;
+
+    // Pushing may call this or other deferred exit functions; an exception
+    // of any of them terminates. A scope_defer destroyed at thread exit
+    // after the queue of the thread calls f at once.
+    void operator()() noexcept
+    {
+        if(defer_queue* q = defer_queue::local()) {
+            q->push(std::move(f));
+        }
+        else {
+            f();
+        }
+    }
+};
+
+// A scope_exit which defers a self-contained exit function to the
+// defer_queue of the thread which destroys it, instead of calling it. The
+// exit function runs at a later flush, after the scope which deferred it
+// has ended: it must own what it uses, or refer only to objects which
+// outlive the flush. A [&] capture of a local variable dangles.
+template <typename EF>
+using scope_defer = scope_exit<deferred_exit_function<EF>>;
+
+template <class EF>
+scope_defer<decay_t<EF>> make_scope_defer(EF&& f SCOPE_SITE_PARAM)
+{
+    return scope_defer<decay_t<EF>>(deferred_exit_function<decay_t<EF>>{std::forward<EF>(f)} SCOPE_SITE_ARG);
+}
+
+// Calls the exit functions deferred on the calling thread, e.g. at a
+// quiescent point of an event loop.
+inline void defer_flush()
+{
+    if(defer_queue* q = defer_queue::local()) {
+        q->flush();
+    }
+}
+
+// The number of exit functions deferred on the calling thread.
+inline std::size_t defer_pending() noexcept
+{
+    defer_queue* q = defer_queue::local();
+    return q ? q->size() : 0;
+}
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+template <std::size_t N = 8>
+class scope_fail_stack : public basic_scope_stack<strategy_fail, N> {};
+
+template <std::size_t N = 8>
+class scope_success_stack : public basic_scope_stack<strategy_success, N> {};
+
+// Exit, success and fail actions sharing one snapshot of
+// std::uncaught_exceptions(): whether the scope failed is decided once when
+// the transaction is destroyed, instead of once per scope_success or
+// scope_fail. Actions are called in reverse order of registration.
+template <std::size_t N = 8>
+class scope_transaction
+{
+    enum kind { kind_exit, kind_success, kind_fail };
+
+public:
+    using handle = typename callback_stack<N>::handle;
+
+    scope_transaction() noexcept = default;
+
+    ~scope_transaction()
+    {
+#if defined(SCOPE_NO_EXCEPTIONS)
+        const kind skipped = kind_fail;
+#else
+        const kind skipped = std::uncaught_exceptions() > uncaught_on_creation_ ? kind_success : kind_fail;
+#endif
+        callbacks_.run([skipped](int k){ return k != skipped; });
+    }
+
+    // Each of these registers f and returns a handle for release(handle). If
+    // f can not be stored, calls f() as the matching scope guard would, and
+    // rethrows.
+    template <typename EFP>
+    handle on_exit(EFP&& f)
+    {
+        return push<kind_exit, strategy_exit>(std::forward<EFP>(f));
+    }
+
+    template <typename EFP>
+    handle on_success(EFP&& f)
+    {
+        return push<kind_success, strategy_success>(std::forward<EFP>(f));
+    }
+
+    template <typename EFP>
+    handle on_fail(EFP&& f)
+    {
+        return push<kind_fail, strategy_fail>(std::forward<EFP>(f));
+    }
+
+    // Drops the action registered as h without calling it. h must not be
+    // used again once released.
+    void release(handle h) noexcept
+    {
+        callbacks_.release(h);
+    }
+
+    // Drops all actions without calling them.
+    void release() noexcept
+    {
+        callbacks_.clear();
+    }
+
+    std::size_t size() const noexcept { return callbacks_.size(); }
+    bool empty() const noexcept { return callbacks_.size() == 0; }
+
+private:
+    template <int Kind, typename Strategy, typename EFP>
+    handle push(EFP&& f)
+    {
+        SCOPE_TRY {
+            return callbacks_.template push<Kind>(std::forward<EFP>(f));
+        }
+        SCOPE_CATCH_ALL {
+            if(Strategy().call_when_construct_failed()) {
+                f();
+            }
+            SCOPE_RETHROW;
+        }
+    }
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+    int uncaught_on_creation_{std::uncaught_exceptions()};
+#endif
+    callback_stack<N> callbacks_;
+};
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+
+// An undo log for transactional code. Undo actions are appended into one
+// contiguous buffer, and called in reverse order by rollback(), or by the
+// destructor unless commit() was called. The first Bytes bytes are stored
+// in the object itself, the buffer moves to the heap beyond that.
+//
+// Undo actions must be trivially copyable, e.g. lambdas capturing pointers,
+// references and scalars: commit() drops them all in O(1) without calling a
+// destructor. They should not throw.
+template <std::size_t Bytes = 256>
+class rollback_log
+{
+    static_assert(Bytes > 0, "Bytes must be greater than 0");
+
+    // Stored after the undo action, so that the log can be walked backwards.
+    struct record_footer
+    {
+        void (*invoke)(void* p);
+        std::size_t size;
+    };
+
+    template <typename F>
+    static void invoke(void* p)
+    {
+        (*static_cast<F*>(p))();
+    }
+
+    static constexpr std::size_t round_up(std::size_t n) noexcept
+    {
+        return (n + alignof(void*) - 1) / alignof(void*) * alignof(void*);
+    }
+
+public:
+    // A position in the log, see mark() and rollback_to().
+    class savepoint
+    {
+        friend class rollback_log;
+        explicit savepoint(std::size_t top) noexcept : top_{top} {}
+        std::size_t top_;
+    };
+
+    rollback_log() noexcept = default;
+
+    rollback_log(const rollback_log&) = delete;
+    rollback_log& operator=(const rollback_log&) = delete;
+
+    ~rollback_log()
+    {
+        rollback();
+        if(buffer_ != inline_buffer_) {
+            ::operator delete(buffer_);
+        }
+    }
+
+    // Appends undo. If undo can not be stored, calls undo() and rethrows.
+    template <typename F>
+    void push(F&& undo)
+    {
+        using U = decay_t<F>;
+        static_assert(std::is_trivially_copyable<U>::value, "undo action must be trivially copyable");
+        static_assert(alignof(U) <= alignof(void*), "undo action must not be over-aligned");
+
+        const std::size_t size = round_up(sizeof(U));
+        SCOPE_TRY {
+            if(capacity_ - top_ < size + sizeof(record_footer)) {
+                grow(size + sizeof(record_footer));
+            }
+        }
+        SCOPE_CATCH_ALL {
+            undo();
+            SCOPE_RETHROW;
+        }
+        ::new(buffer_ + top_) U(std::forward<F>(undo));
+        record_footer footer{&invoke<U>, size};
+        std::memcpy(buffer_ + top_ + size, &footer, sizeof(footer));
+        top_ += size + sizeof(record_footer);
+    }
+
+    savepoint mark() const noexcept
+    {
+        return savepoint{top_};
+    }
+
+    // Calls the undo actions appended after sp in reverse order, and drops them.
+    void rollback_to(savepoint sp)
+    {
+        while(top_ > sp.top_) {
+            record_footer footer;
+            std::memcpy(&footer, buffer_ + top_ - sizeof(record_footer), sizeof(footer));
+            top_ -= sizeof(record_footer) + footer.size;
+            footer.invoke(buffer_ + top_);
+        }
+    }
+
+    void rollback()
+    {
+        rollback_to(savepoint{0});
+    }
+
+    // Drops all undo actions without calling them.
+    void commit() noexcept
+    {
+        top_ = 0;
+    }
+
+    bool empty() const noexcept { return top_ == 0; }
+
+private:
+    void grow(std::size_t n)
+    {
+        std::size_t capacity = capacity_ * 2;
+        while(capacity - top_ < n) {
+            capacity *= 2;
+        }
+        unsigned char* buffer = static_cast<unsigned char*>(::operator new(capacity));
+        std::memcpy(buffer, buffer_, top_);
+        if(buffer_ != inline_buffer_) {
+            ::operator delete(buffer_);
+        }
+        buffer_ = buffer;
+        capacity_ = capacity;
+    }
+
+    std::size_t top_{0};
+    std::size_t capacity_{Bytes};
+    unsigned char* buffer_{inline_buffer_};
+    alignas(void*) unsigned char inline_buffer_[Bytes];
+};
+
+// A deleter which calls the function Fn known at compile time. It is empty,
+// and the call is direct so that it can be inlined, unlike a deleter of
+// function pointer type.
+template <typename F, F Fn>
+struct basic_static_deleter
+{
+    template <typename... Args>
+    auto operator()(Args&&... args) const noexcept(noexcept(Fn(std::forward<Args>(args)...)))
+        -> decltype(Fn(std::forward<Args>(args)...))
+    {
+        return Fn(std::forward<Args>(args)...);
+    }
+};
+
+#if defined(SCOPE_USE_STATIC_DELETER)
+template <auto Fn>
+using static_deleter = basic_static_deleter<decltype(Fn), Fn>;
+#endif // defined(SCOPE_USE_STATIC_DELETER)
+
+// Traits for unique_sentinel_resource: a resource equal to Invalid is not owned.
+template <typename R, R Invalid>
+struct sentinel_traits
+{
+    static constexpr R invalid() noexcept { return Invalid; }
+};
+
+// A unique_resource which encodes "not owned" as Traits::invalid() instead
+// of keeping a separate flag, and stores an empty deleter in no space.
+// It holds just an R for handles such as file descriptors.
+//
+// Unlike unique_resource, release() gives up ownership by storing the
+// invalid value and returns the released resource.
+template <typename R, typename D, typename Traits>
+class unique_sentinel_resource : private compressed_storage<D>
+{
+    static_assert(!std::is_reference<R>::value, "R must not be a reference");
+    static_assert(std::is_nothrow_copy_constructible<R>::value && std::is_nothrow_copy_assignable<R>::value,
+                  "R must be nothrow copyable");
+
+    using deleter_type = compressed_storage<D>;
+
+public:
+    unique_sentinel_resource() noexcept(std::is_nothrow_default_constructible<D>::value)
+        : deleter_type{D{}}
+        , resource_(Traits::invalid())
+    {}
+
+    SCOPE_TEMPLATE((typename RR, typename DD),
+        std::is_constructible<R, RR>::value && std::is_constructible<D, DD>::value &&
+        (std::is_nothrow_constructible<D, DD>::value || std::is_constructible<D, DD&>::value))
+    unique_sentinel_resource(RR&& r, DD&& d)
+            noexcept(std::is_nothrow_constructible<D, DD>::value || std::is_nothrow_constructible<D, DD&>::value)
+        : deleter_type{make_construct_guard<deleter_type, forwarded_t<D, DD>>([&r, &d]{ if(!bool(r == Traits::invalid())) d(r); }), forward_if_nothrow_constructible<D, DD>(std::forward<DD>(d))}
+        , resource_(std::forward<RR>(r))
+    {}
+
+    unique_sentinel_resource(const unique_sentinel_resource&) = delete;
+    unique_sentinel_resource& operator=(const unique_sentinel_resource&) = delete;
+
+    unique_sentinel_resource(unique_sentinel_resource&& rhs) noexcept(std::is_nothrow_move_constructible<D>::value)
+        : deleter_type{make_construct_guard<deleter_type, decltype(std::move_if_noexcept(rhs.deleter()))>([&rhs]{ rhs.reset(); }), std::move_if_noexcept(rhs.deleter())}
+        , resource_(exchange(rhs.resource_, Traits::invalid()))
+    {}
+
+    unique_sentinel_resource& operator=(unique_sentinel_resource&& rhs) noexcept(std::is_nothrow_move_assignable<D>::value)
+    {
+        if(this != &rhs) {
+            reset();
+            deleter() = forward_if_nothrow_move_assignable<D>(rhs.deleter());
+            resource_ = exchange(rhs.resource_, Traits::invalid());
+        }
+        return *this;
+    }
+
+    ~unique_sentinel_resource()
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        if(!bool(resource_ == Traits::invalid())) {
+            deleter()(exchange(resource_, Traits::invalid()));
+        }
+    }
+
+    SCOPE_TEMPLATE((typename RR), std::is_nothrow_assignable<R&, RR>::value)
+    void reset(RR&& r) noexcept
+    {
+        reset();
+        resource_ = std::forward<RR>(r);
+    }
+
+    R release() noexcept
+    {
+        return exchange(resource_, Traits::invalid());
+    }
+
+    const R& get() const noexcept
+    {
+        return resource_;
+    }
+
+    SCOPE_TEMPLATE((typename RR = R),
+        std::is_pointer<RR>::value && !std::is_void<typename std::remove_pointer<RR>::type>::value)
+    typename std::add_lvalue_reference<typename std::remove_pointer<RR>::type>::type operator*() const noexcept
+    {
+        return *get();
+    }
+
+    SCOPE_TEMPLATE((typename RR = R), std::is_pointer<RR>::value)
+    RR operator->() const noexcept
+    {
+        return get();
+    }
+
+    const D& get_deleter() const noexcept
+    {
+        return deleter_type::get();
+    }
+
+private:
+    D& deleter() noexcept { return deleter_type::get(); }
+
+    R resource_;
+};
+
+template <typename Traits, typename R, typename D>
+unique_sentinel_resource<decay_t<R>, decay_t<D>, Traits>
+make_unique_sentinel_resource(R&& r, D&& d)
+        noexcept(std::is_nothrow_constructible<decay_t<D>, D>::value)
+{
+    return unique_sentinel_resource<decay_t<R>, decay_t<D>, Traits>{std::forward<R>(r), std::forward<D>(d)};
+}
+
+// A batch deleter deletes any number of resources with one call
+// d(first, n). It may reorder or modify the n resources.
+template <typename D, typename R, typename = void>
+struct is_batch_deleter : public std::false_type {};
+
+template <typename D, typename R>
+struct is_batch_deleter<D, R, decltype(std::declval<D&>()(std::declval<R*>(), std::size_t{}), void())> : public std::true_type {};
+
+// Owns an array of resources with one deleter. The resources are stored
+// contiguously and their ownership in a bitmask, instead of a deleter and a
+// bool per element as in std::vector<unique_resource<R, D>>.
+//
+// If D is a batch deleter, reset() moves the owned resources to the front
+// and deletes all of them with one call. Otherwise D is called on each owned
+// resource in order.
+template <typename R, typename D>
+class unique_resource_array : private compressed_storage<D>
+{
+    static_assert(!std::is_reference<R>::value, "R must not be a reference");
+    static_assert(std::is_nothrow_move_constructible<R>::value && std::is_nothrow_move_assignable<R>::value,
+                  "R must be nothrow movable");
+    static_assert(alignof(R) <= alignof(std::max_align_t), "R must not be over-aligned");
+
+    using deleter_type = compressed_storage<D>;
+    using word = std::size_t;
+
+    static constexpr std::size_t word_bits = sizeof(word) * CHAR_BIT;
+
+public:
+    using size_type = std::size_t;
+
+    unique_resource_array() noexcept(std::is_nothrow_default_constructible<D>::value)
+        : deleter_type{D{}}
+    {}
+
+    SCOPE_TEMPLATE((typename DD), std::is_constructible<D, DD>::value)
+    explicit unique_resource_array(DD&& d) noexcept(std::is_nothrow_constructible<D, DD>::value)
+        : deleter_type{std::forward<DD>(d)}
+    {}
+
+    unique_resource_array(const unique_resource_array&) = delete;
+    unique_resource_array& operator=(const unique_resource_array&) = delete;
+
+    unique_resource_array(unique_resource_array&& rhs) noexcept(std::is_nothrow_move_constructible<D>::value)
+        : deleter_type{std::move_if_noexcept(rhs.deleter())}
+        , data_{detail::exchange(rhs.data_, nullptr)}
+        , owned_{detail::exchange(rhs.owned_, nullptr)}
+        , size_{detail::exchange(rhs.size_, 0)}
+        , capacity_{detail::exchange(rhs.capacity_, 0)}
+    {}
+
+    unique_resource_array& operator=(unique_resource_array&& rhs) noexcept(std::is_nothrow_move_assignable<D>::value)
+    {
+        if(this != &rhs) {
+            reset();
+            deallocate();
+            deleter() = std::move_if_noexcept(rhs.deleter());
+            data_ = detail::exchange(rhs.data_, nullptr);
+            owned_ = detail::exchange(rhs.owned_, nullptr);
+            size_ = detail::exchange(rhs.size_, 0);
+            capacity_ = detail::exchange(rhs.capacity_, 0);
+        }
+        return *this;
+    }
+
+    ~unique_resource_array()
+    {
+        reset();
+        deallocate();
+    }
+
+    // Appends r and takes ownership of it. If r can not be stored, deletes it
+    // and rethrows, as the constructor of unique_resource does.
+    SCOPE_TEMPLATE((typename RR), std::is_nothrow_constructible<R, RR>::value)
+    size_type push_back(RR&& r)
+    {
+        if(size_ == capacity_) {
+            auto g = make_untracked_scope_exit([this, &r]{
+                R tmp(std::forward<RR>(r));
+                delete_one(tmp, is_batch_deleter<D, R>{});
+            });
+            grow();
+            g.release();
+        }
+        ::new(static_cast<void*>(data_ + size_)) R(std::forward<RR>(r));
+        owned_[size_ / word_bits] |= word(1) << (size_ % word_bits);
+        return size_++;
+    }
+
+    // Deletes all owned resources and removes all elements.
+    void reset() noexcept
+    {
+        delete_owned(is_batch_deleter<D, R>{});
+        destroy_elements();
+    }
+
+    // Deletes the resource at i if it is owned. The element stays, not owned.
+    void reset(size_type i) noexcept
+    {
+        if(owns(i)) {
+            owned_[i / word_bits] &= ~(word(1) << (i % word_bits));
+            delete_one(data_[i], is_batch_deleter<D, R>{});
+        }
+    }
+
+    // Gives up ownership of all resources. The elements stay, not owned.
+    void release() noexcept
+    {
+        for(size_type w = 0; w < words(size_); ++w) {
+            owned_[w] = 0;
+        }
+    }
+
+    void release(size_type i) noexcept
+    {
+        owned_[i / word_bits] &= ~(word(1) << (i % word_bits));
+    }
+
+    bool owns(size_type i) const noexcept
+    {
+        return (owned_[i / word_bits] >> (i % word_bits)) & 1;
+    }
+
+    const R& operator[](size_type i) const noexcept { return data_[i]; }
+    const R* data() const noexcept { return data_; }
+    size_type size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    const D& get_deleter() const noexcept
+    {
+        return deleter_type::get();
+    }
+
+private:
+    D& deleter() noexcept { return deleter_type::get(); }
+
+    static size_type words(size_type n) noexcept { return (n + word_bits - 1) / word_bits; }
+
+    void delete_one(R& r, std::true_type) noexcept { deleter()(&r, 1); }
+    void delete_one(R& r, std::false_type) noexcept { deleter()(r); }
+
+    // Moves the owned resources to the front, skipping whole words of owned
+    // resources which are already in place, and deletes them at once.
+    void delete_owned(std::true_type) noexcept
+    {
+        size_type n = 0;
+        for(size_type w = 0; w < words(size_); ++w) {
+            const size_type base = w * word_bits;
+            word bits = owned_[w];
+            if(bits == ~word(0) && n == base) {
+                n += word_bits;
+                continue;
+            }
+            for(size_type i = base; bits != 0; ++i, bits >>= 1) {
+                if(bits & 1) {
+                    if(n != i) {
+                        data_[n] = std::move(data_[i]);
+                    }
+                    ++n;
+                }
+            }
+        }
+        if(n > 0) {
+            deleter()(data_, n);
+        }
+    }
+
+    void delete_owned(std::false_type) noexcept
+    {
+        for(size_type w = 0; w < words(size_); ++w) {
+            word bits = owned_[w];
+            for(size_type i = w * word_bits; bits != 0; ++i, bits >>= 1) {
+                if(bits & 1) {
+                    deleter()(data_[i]);
+                }
+            }
+        }
+    }
+
+    void destroy_elements() noexcept
+    {
+        for(size_type i = size_; i > 0; --i) {
+            data_[i - 1].~R();
+        }
+        for(size_type w = 0; w < words(size_); ++w) {
+            owned_[w] = 0;
+        }
+        size_ = 0;
+    }
+
+    // The resources and the bitmask share one allocation. The capacity is a
+    // multiple of word_bits, so the bitmask which follows the resources is
+    // aligned.
+    void grow()
+    {
+        const size_type capacity = capacity_ ? capacity_ * 2 : word_bits;
+        void* p = ::operator new(capacity * sizeof(R) + words(capacity) * sizeof(word));
+        R* data = static_cast<R*>(p);
+        word* owned = reinterpret_cast<word*>(data + capacity);
+        for(size_type i = 0; i < size_; ++i) {
+            ::new(static_cast<void*>(data + i)) R(std::move(data_[i]));
+            data_[i].~R();
+        }
+        if(capacity_ > 0) {
+            std::memcpy(owned, owned_, words(capacity_) * sizeof(word));
+        }
+        std::memset(owned + words(capacity_), 0, (words(capacity) - words(capacity_)) * sizeof(word));
+        deallocate();
+        data_ = data;
+        owned_ = owned;
+        capacity_ = capacity;
+    }
+
+    void deallocate() noexcept
+    {
+        ::operator delete(data_);
+        data_ = nullptr;
+        owned_ = nullptr;
+        capacity_ = 0;
+    }
+
+    R* data_{nullptr};
+    word* owned_{nullptr};
+    size_type size_{0};
+    size_type capacity_{0};
+};
+
+#if defined(SCOPE_EXTERN_TEMPLATE)
+SCOPE_EXTERN_TEMPLATE class scope_guard<void(*)(), strategy_exit>;
+SCOPE_EXTERN_TEMPLATE class scope_exit<void(*)()>;
+SCOPE_EXTERN_TEMPLATE class scope_guard<std::function<void()>, strategy_exit>;
+SCOPE_EXTERN_TEMPLATE class scope_exit<std::function<void()>>;
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+SCOPE_EXTERN_TEMPLATE class scope_guard<std::function<void()>, strategy_fail>;
+SCOPE_EXTERN_TEMPLATE class scope_fail<std::function<void()>>;
+SCOPE_EXTERN_TEMPLATE class scope_guard<std::function<void()>, strategy_success>;
+SCOPE_EXTERN_TEMPLATE class scope_success<std::function<void()>>;
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+SCOPE_EXTERN_TEMPLATE class unique_resource<int, int(*)(int)>;
+SCOPE_EXTERN_TEMPLATE class unique_resource<std::FILE*, int(*)(std::FILE*)>;
+SCOPE_EXTERN_TEMPLATE class unique_resource<void*, void(*)(void*)>;
+#endif // defined(SCOPE_EXTERN_TEMPLATE)
+
 } // namespace detail
 
-using detail::scope_exit;
-using detail::make_scope_exit;
+SCOPE_EXPORT using detail::scope_exit;
+SCOPE_EXPORT using detail::make_scope_exit;
+SCOPE_EXPORT using detail::scope_guard;
+SCOPE_EXPORT using detail::make_scope_guard;
+SCOPE_EXPORT using detail::strategy_exit;
+SCOPE_EXPORT using detail::strategy_error;
+SCOPE_EXPORT using detail::make_scope_error;
+SCOPE_EXPORT using detail::strategy_flag;
+SCOPE_EXPORT using detail::make_scope_flag;
+SCOPE_EXPORT using detail::strategy_cancel;
+SCOPE_EXPORT using detail::make_scope_cancel;
+using detail::scope_defer;
+using detail::make_scope_defer;
+using detail::defer_flush;
+using detail::defer_pending;
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+SCOPE_EXPORT using detail::scope_fail;
+SCOPE_EXPORT using detail::strategy_fail;
+SCOPE_EXPORT using detail::strategy_success;
+SCOPE_EXPORT using detail::make_scope_fail;
+SCOPE_EXPORT using detail::scope_success;
+SCOPE_EXPORT using detail::make_scope_success;
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+
+SCOPE_EXPORT using detail::unique_resource;
+SCOPE_EXPORT using detail::null_resource_policy;
+SCOPE_EXPORT using detail::make_unique_resource;
+SCOPE_EXPORT using detail::make_unique_resource_checked;
 
+using detail::scope_exit_stack;
 #if defined(SCOPE_USE_SUCCESS_FAIL)
-using detail::scope_fail;
-using detail::make_scope_fail;
-using detail::scope_success;
-using detail::make_scope_success;
+using detail::scope_fail_stack;
+using detail::scope_success_stack;
+using detail::scope_transaction;
 #endif // defined(SCOPE_USE_SUCCESS_FAIL)
 
-using detail::unique_resource;
-using detail::make_unique_resource;
-using detail::make_unique_resource_checked;
+using detail::rollback_log;
+
+using detail::basic_static_deleter;
+#if defined(SCOPE_USE_STATIC_DELETER)
+using detail::static_deleter;
+#endif // defined(SCOPE_USE_STATIC_DELETER)
+
+using detail::sentinel_traits;
+using detail::unique_sentinel_resource;
+using detail::make_unique_sentinel_resource;
+
+using detail::is_batch_deleter;
+using detail::unique_resource_array;
+
+#if defined(SCOPE_HAS_USDT)
+} // inline namespace usdt
+#endif
+
+#if defined(SCOPE_NO_EXCEPTIONS)
+} // inline namespace noexcept_
+#endif
+
+#if defined(SCOPE_ENABLE_INSTRUMENTATION) || defined(SCOPE_ENABLE_LIVE_REGISTRY)
+} // inline namespace
+#endif
 
 } // namespace scope
 
+// basic_static_deleter for the function fn, for C++11/14 which doesn't have
+// static_deleter<&fn>.
+#define SCOPE_STATIC_DELETER(fn) ::scope::basic_static_deleter<decltype(&fn), &fn>
+
 #endif // NAKATT_SCOPE_HPP_
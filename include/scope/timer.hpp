@@ -0,0 +1,197 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_SCOPE_TIMER_HPP_
+#define NAKATT_SCOPE_TIMER_HPP_
+
+#include "histogram.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace scope {
+
+namespace detail {
+
+// A timed region, in the list of every region which has been entered.
+struct timer_entry
+{
+    const char* (*name)();
+    const char* unit;
+    const histogram* h;
+    timer_entry* next;
+};
+
+inline std::atomic<timer_entry*>& timer_entries() noexcept
+{
+    static std::atomic<timer_entry*> head{nullptr};
+    return head;
+}
+
+// The histogram of a region. It is never destroyed, so that the list of
+// regions can be walked, and regions entered, during and after static
+// destruction.
+template <typename Region, typename Clock>
+class timer_region
+{
+public:
+    static timer_region& get() noexcept
+    {
+        static immortal<timer_region> r;
+        return r.get();
+    }
+
+    histogram h;
+
+private:
+    friend class immortal<timer_region>;
+
+    timer_region() noexcept
+    {
+        std::atomic<timer_entry*>& head = timer_entries();
+        entry_.next = head.load(std::memory_order_relaxed);
+        while(!head.compare_exchange_weak(entry_.next, &entry_, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    timer_entry entry_{&Region::name, Clock::unit(), &h, nullptr};
+};
+
+template <typename Region, typename Clock>
+struct timer_exit_function
+{
+    std::uint64_t start;
+
+    void operator()() const noexcept
+    {
+        timer_region<Region, Clock>::get().h.record(Clock::now() - start);
+    }
+};
+
+inline void append_json_string(std::string& out, const char* s)
+{
+    out += '"';
+    for(; *s; ++s) {
+        const unsigned char c = static_cast<unsigned char>(*s);
+        if(c == '"' || c == '\\') {
+            out += '\\';
+            out += *s;
+        }
+        else if(c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else {
+            out += *s;
+        }
+    }
+    out += '"';
+}
+
+} // namespace detail
+
+// A scope_exit which records the time spent in its scope into the histogram
+// of Region, in ticks of Clock (steady_ticks or tsc_ticks). Region is a type
+// with a static member function name(), see SCOPE_TIMER_REGION; each Region
+// and Clock has one histogram for the whole program. release() drops the
+// measurement.
+template <typename Region, typename Clock = steady_ticks>
+using scope_timer = scope_exit<detail::timer_exit_function<Region, Clock>>;
+
+template <typename Region, typename Clock = steady_ticks>
+scope_timer<Region, Clock> make_scope_timer() noexcept
+{
+    return scope_timer<Region, Clock>(detail::timer_exit_function<Region, Clock>{Clock::now()});
+}
+
+// The histogram of the region.
+template <typename Region, typename Clock = steady_ticks>
+histogram& timer_histogram() noexcept
+{
+    return detail::timer_region<Region, Clock>::get().h;
+}
+
+// Calls f(name, unit, snapshot) for every region entered so far, without a
+// lock. snapshot is a histogram_snapshot reused between the calls. It may be
+// called at any time, from static destructors too.
+template <typename F>
+void for_each_timer(F&& f)
+{
+    histogram_snapshot s;
+    for(const detail::timer_entry* e = detail::timer_entries().load(std::memory_order_acquire); e; e = e->next) {
+        e->h->snapshot(s);
+        f(static_cast<const char*>(e->name()), e->unit, static_cast<const histogram_snapshot&>(s));
+    }
+}
+
+// A line per region: name, unit, count, mean and percentiles.
+inline std::string timer_report_text()
+{
+    std::string out;
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "%-24s %-6s %12s %12s %12s %12s %12s %12s %12s\n",
+                  "region", "unit", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    out += buf;
+    for_each_timer([&](const char* name, const char* unit, const histogram_snapshot& s) {
+        std::snprintf(buf, sizeof(buf), "%-24s %-6s %12llu %12.1f %12llu %12llu %12llu %12llu %12llu\n",
+                      name, unit, static_cast<unsigned long long>(s.count()), s.mean(),
+                      static_cast<unsigned long long>(s.percentile(50)), static_cast<unsigned long long>(s.percentile(90)),
+                      static_cast<unsigned long long>(s.percentile(99)), static_cast<unsigned long long>(s.percentile(99.9)),
+                      static_cast<unsigned long long>(s.max()));
+        out += buf;
+    });
+    return out;
+}
+
+// {"timers": [{"region": ..., "unit": ..., "count": ..., ...}, ...]}
+inline std::string timer_report_json()
+{
+    std::string out = "{\"timers\": [";
+    const char* sep = "";
+    char buf[256];
+    for_each_timer([&](const char* name, const char* unit, const histogram_snapshot& s) {
+        out += sep;
+        out += "{\"region\": ";
+        detail::append_json_string(out, name);
+        out += ", \"unit\": ";
+        detail::append_json_string(out, unit);
+        std::snprintf(buf, sizeof(buf), ", \"count\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p99.9\": %llu, \"max\": %llu}",
+                      static_cast<unsigned long long>(s.count()), s.mean(),
+                      static_cast<unsigned long long>(s.percentile(50)), static_cast<unsigned long long>(s.percentile(90)),
+                      static_cast<unsigned long long>(s.percentile(99)), static_cast<unsigned long long>(s.percentile(99.9)),
+                      static_cast<unsigned long long>(s.max()));
+        out += buf;
+        sep = ", ";
+    });
+    out += "]}";
+    return out;
+}
+
+} // namespace scope
+
+// Declares tag, a Region of scope_timer named region_name.
+#define SCOPE_TIMER_REGION(tag, region_name) \
+    struct tag { static const char* name() noexcept { return region_name; } }
+
+#endif // NAKATT_SCOPE_TIMER_HPP_
@@ -0,0 +1,306 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_SCOPE_URING_CLOSE_HPP_
+#define NAKATT_SCOPE_URING_CLOSE_HPP_
+
+#include "scope.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#   if __has_include(<linux/io_uring.h>)
+#       define SCOPE_USE_IO_URING
+#   endif
+#endif
+
+#if defined(SCOPE_USE_IO_URING)
+#   include <linux/io_uring.h>
+#   include <sys/mman.h>
+#   include <sys/syscall.h>
+#endif
+
+namespace scope {
+
+namespace detail {
+
+#if defined(SCOPE_USE_IO_URING)
+
+// A per-thread io_uring which closes fds in batches. close() only writes a
+// submission queue entry; the queued closes are submitted with one
+// io_uring_enter() when the queue is full, on flush(), and when the thread
+// exits. If io_uring can not be set up or does not support IORING_OP_CLOSE,
+// fds are closed synchronously.
+class uring_closer
+{
+public:
+    static constexpr unsigned entries = 256;
+
+    uring_closer() noexcept
+    {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        const long fd = ::syscall(__NR_io_uring_setup, entries, &p);
+        if(fd < 0) {
+            return;
+        }
+        ring_fd_ = static_cast<int>(fd);
+
+        sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        if(p.features & IORING_FEAT_SINGLE_MMAP) {
+            sq_ring_size_ = cq_ring_size_ = sq_ring_size_ > cq_ring_size_ ? sq_ring_size_ : cq_ring_size_;
+        }
+        sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = (p.features & IORING_FEAT_SINGLE_MMAP) ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+        if(!sq_ring_ || !cq_ring_ || !sqes_) {
+            teardown();
+            return;
+        }
+
+        sq_head_ = field(sq_ring_, p.sq_off.head);
+        sq_tail_ = field(sq_ring_, p.sq_off.tail);
+        sq_mask_ = *field(sq_ring_, p.sq_off.ring_mask);
+        sq_array_ = field(sq_ring_, p.sq_off.array);
+        sq_entries_ = p.sq_entries;
+        cq_head_ = field(cq_ring_, p.cq_off.head);
+        cq_tail_ = field(cq_ring_, p.cq_off.tail);
+        cq_mask_ = *field(cq_ring_, p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cq_ring_) + p.cq_off.cqes);
+        tail_ = *sq_tail_;
+    }
+
+    uring_closer(const uring_closer&) = delete;
+    uring_closer& operator=(const uring_closer&) = delete;
+
+    ~uring_closer()
+    {
+        flush();
+        teardown();
+    }
+
+    // The closer of the calling thread.
+    static uring_closer& local() noexcept
+    {
+        static thread_local uring_closer closer;
+        return closer;
+    }
+
+    void close(int fd) noexcept
+    {
+        if(ring_fd_ < 0) {
+            ::close(fd);
+            return;
+        }
+        if(pending() == sq_entries_) {
+            flush();
+            if(ring_fd_ < 0) {
+                ::close(fd);
+                return;
+            }
+        }
+        const unsigned index = tail_ & sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_CLOSE;
+        sqe.fd = fd;
+        sqe.user_data = static_cast<unsigned>(fd);
+        sq_array_[index] = index;
+        ++tail_;
+    }
+
+    // Submits the queued closes and waits for them.
+    void flush() noexcept
+    {
+        unsigned n = pending();
+        if(n == 0) {
+            return;
+        }
+        __atomic_store_n(sq_tail_, tail_, __ATOMIC_RELEASE);
+        while(n > 0) {
+            const long r = ::syscall(__NR_io_uring_enter, ring_fd_, n, n, IORING_ENTER_GETEVENTS, nullptr, 0);
+            // A ring that submits nothing would make no progress, so it is
+            // given up like a failing one.
+            if(r <= 0) {
+                if(r < 0 && errno == EINTR) {
+                    continue;
+                }
+                close_unsubmitted();
+                teardown();
+                return;
+            }
+            n -= static_cast<unsigned>(r);
+            reap();
+            if(ring_fd_ < 0) {
+                return;
+            }
+        }
+    }
+
+    // The number of queued closes not submitted yet.
+    unsigned pending() const noexcept
+    {
+        return ring_fd_ < 0 ? 0 : tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    }
+
+    bool uses_io_uring() const noexcept { return ring_fd_ >= 0; }
+
+private:
+    void* map(std::size_t size, off_t offset) noexcept
+    {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    static unsigned* field(void* ring, unsigned offset) noexcept
+    {
+        return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+    }
+
+    // A kernel without IORING_OP_CLOSE fails the close with EINVAL: close the
+    // fd here, and every later one too.
+    void reap() noexcept
+    {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        bool unsupported = false;
+        for(; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            if(cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+                ::close(static_cast<int>(cqe.user_data));
+                unsupported = true;
+            }
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        if(unsupported) {
+            close_unsubmitted();
+            teardown();
+        }
+    }
+
+    void close_unsubmitted() noexcept
+    {
+        for(unsigned i = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE); i != tail_; ++i) {
+            ::close(sqes_[sq_array_[i & sq_mask_]].fd);
+        }
+        tail_ = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    }
+
+    void teardown() noexcept
+    {
+        if(sqes_) {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if(cq_ring_ && cq_ring_ != sq_ring_) {
+            ::munmap(cq_ring_, cq_ring_size_);
+        }
+        if(sq_ring_) {
+            ::munmap(sq_ring_, sq_ring_size_);
+        }
+        if(ring_fd_ >= 0) {
+            ::close(ring_fd_);
+        }
+        sqes_ = nullptr;
+        cq_ring_ = sq_ring_ = nullptr;
+        ring_fd_ = -1;
+    }
+
+    int ring_fd_{-1};
+    unsigned tail_{0};
+    unsigned sq_entries_{0};
+    unsigned sq_mask_{0};
+    unsigned cq_mask_{0};
+    unsigned* sq_head_{nullptr};
+    unsigned* sq_tail_{nullptr};
+    unsigned* sq_array_{nullptr};
+    unsigned* cq_head_{nullptr};
+    unsigned* cq_tail_{nullptr};
+    io_uring_sqe* sqes_{nullptr};
+    io_uring_cqe* cqes_{nullptr};
+    void* sq_ring_{nullptr};
+    void* cq_ring_{nullptr};
+    std::size_t sq_ring_size_{0};
+    std::size_t cq_ring_size_{0};
+    std::size_t sqes_size_{0};
+};
+
+#else
+
+// Without io_uring every fd is closed synchronously.
+class uring_closer
+{
+public:
+    static uring_closer& local() noexcept
+    {
+        static uring_closer closer;
+        return closer;
+    }
+
+    void close(int fd) noexcept { ::close(fd); }
+    void flush() noexcept {}
+    unsigned pending() const noexcept { return 0; }
+    bool uses_io_uring() const noexcept { return false; }
+};
+
+#endif // defined(SCOPE_USE_IO_URING)
+
+} // namespace detail
+
+// A deleter for fds which closes them in batches on an io_uring of the
+// calling thread: unique_resource<int, uring_close>. An fd stays open until
+// its batch is submitted, when 256 closes are queued, on
+// uring_close_flush() or when the thread exits.
+struct uring_close
+{
+    void operator()(int fd) const noexcept
+    {
+        detail::uring_closer::local().close(fd);
+    }
+};
+
+// Closes the fds queued by uring_close on the calling thread.
+inline void uring_close_flush() noexcept
+{
+    detail::uring_closer::local().flush();
+}
+
+// The number of fds queued by uring_close on the calling thread.
+inline std::size_t uring_close_pending() noexcept
+{
+    return detail::uring_closer::local().pending();
+}
+
+// Whether uring_close closes fds through io_uring on the calling thread, or
+// falls back to close().
+inline bool uring_close_available() noexcept
+{
+    return detail::uring_closer::local().uses_io_uring();
+}
+
+} // namespace scope
+
+#endif // NAKATT_SCOPE_URING_CLOSE_HPP_
@@ -0,0 +1,227 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <utility>
+
+#include "perf.hpp"
+
+namespace {
+
+constexpr std::uint64_t normal_iterations = 1000000;
+constexpr std::uint64_t unwind_iterations = 20000;
+
+int counter = 0;
+
+struct close_handle
+{
+    void operator()(int h) const noexcept { counter += h; }
+};
+
+// The loop alone, to subtract from the normal path cases.
+void loop(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        ++counter;
+        perf::clobber_memory();
+    }
+}
+
+void scope_exit(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        auto g = scope::make_scope_exit([]{ ++counter; });
+        perf::clobber_memory();
+    }
+}
+
+void scope_exit_released(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        auto g = scope::make_scope_exit([]{ ++counter; });
+        perf::clobber_memory();
+        g.release();
+    }
+}
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+void scope_fail(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        auto g = scope::make_scope_fail([]{ ++counter; });
+        perf::clobber_memory();
+    }
+}
+
+void scope_success(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        auto g = scope::make_scope_success([]{ ++counter; });
+        perf::clobber_memory();
+    }
+}
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+
+// The failure is a value bound to the guard: every other iteration fails.
+void scope_error(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        int err = 0;
+        auto g = scope::make_scope_error([]{ ++counter; }, err);
+        perf::clobber_memory();
+        err = static_cast<int>(i & 1);
+    }
+}
+
+void scope_flag(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        bool failed = true;
+        auto g = scope::make_scope_flag([]{ ++counter; }, failed);
+        perf::clobber_memory();
+        failed = (i & 1) != 0;
+    }
+}
+
+// The unwinding path: the guard is destroyed by a throw caught one frame
+// up. unwind/throw is the cost of the throw alone.
+__attribute__((noinline)) void throw_alone()
+{
+    perf::clobber_memory();
+    throw 42;
+}
+
+template <void (*Body)()>
+void unwind(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        try {
+            Body();
+        }
+        catch(int) {
+        }
+    }
+}
+
+__attribute__((noinline)) void throw_scope_exit()
+{
+    auto g = scope::make_scope_exit([]{ ++counter; });
+    perf::clobber_memory();
+    throw 42;
+}
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+__attribute__((noinline)) void throw_scope_fail()
+{
+    auto g = scope::make_scope_fail([]{ ++counter; });
+    perf::clobber_memory();
+    throw 42;
+}
+
+__attribute__((noinline)) void throw_scope_success()
+{
+    auto g = scope::make_scope_success([]{ ++counter; });
+    perf::clobber_memory();
+    throw 42;
+}
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+
+void resource_construct(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        scope::unique_resource<int, close_handle> r{static_cast<int>(i), close_handle{}};
+        perf::clobber_memory();
+    }
+}
+
+void resource_construct_checked(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        auto r = scope::make_unique_resource_checked(static_cast<int>(i & 1) - 1, -1, close_handle{});
+        perf::clobber_memory();
+    }
+}
+
+void resource_move(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        scope::unique_resource<int, close_handle> r{static_cast<int>(i), close_handle{}};
+        perf::clobber_memory();
+        scope::unique_resource<int, close_handle> r2{std::move(r)};
+        perf::clobber_memory();
+    }
+}
+
+void resource_move_assign(std::uint64_t iterations)
+{
+    scope::unique_resource<int, close_handle> r{0, close_handle{}};
+    for(auto i = iterations; i; --i) {
+        scope::unique_resource<int, close_handle> r2{static_cast<int>(i), close_handle{}};
+        perf::clobber_memory();
+        r = std::move(r2);
+        perf::clobber_memory();
+    }
+}
+
+void resource_reset(std::uint64_t iterations)
+{
+    scope::unique_resource<int, close_handle> r{0, close_handle{}};
+    for(auto i = iterations; i; --i) {
+        r.reset(static_cast<int>(i));
+        perf::clobber_memory();
+    }
+}
+
+void resource_release(std::uint64_t iterations)
+{
+    for(auto i = iterations; i; --i) {
+        scope::unique_resource<int, close_handle> r{static_cast<int>(i), close_handle{}};
+        perf::clobber_memory();
+        r.release();
+    }
+}
+
+perf::registrar registrars[] = {
+    {"loop", &loop, normal_iterations},
+    {"scope_guard/scope_exit", &scope_exit, normal_iterations},
+    {"scope_guard/scope_exit/released", &scope_exit_released, normal_iterations},
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+    {"scope_guard/scope_fail", &scope_fail, normal_iterations},
+    {"scope_guard/scope_success", &scope_success, normal_iterations},
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+    {"scope_guard/scope_error", &scope_error, normal_iterations},
+    {"scope_guard/scope_flag", &scope_flag, normal_iterations},
+    {"unwind/throw", &unwind<&throw_alone>, unwind_iterations},
+    {"unwind/scope_exit", &unwind<&throw_scope_exit>, unwind_iterations},
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+    {"unwind/scope_fail", &unwind<&throw_scope_fail>, unwind_iterations},
+    {"unwind/scope_success", &unwind<&throw_scope_success>, unwind_iterations},
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+    {"unique_resource/construct", &resource_construct, normal_iterations},
+    {"unique_resource/construct_checked", &resource_construct_checked, normal_iterations},
+    {"unique_resource/move", &resource_move, normal_iterations},
+    {"unique_resource/move_assign", &resource_move_assign, normal_iterations},
+    {"unique_resource/reset", &resource_reset, normal_iterations},
+    {"unique_resource/release", &resource_release, normal_iterations},
+};
+
+} // namespace
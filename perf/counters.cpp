@@ -0,0 +1,198 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "counters.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+const char* event_name(event e) noexcept
+{
+    switch(e) {
+    case instructions:  return "instructions";
+    case branches:      return "branches";
+    case branch_misses: return "branch-misses";
+    case l1d_misses:    return "L1d-misses";
+    default:            return "?";
+    }
+}
+
+#if defined(__linux__)
+
+namespace {
+
+int open_event(event e)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    switch(e) {
+    case instructions:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case branches:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS;
+        break;
+    case branch_misses:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    default:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    }
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+std::string reason(int error)
+{
+    std::string s = std::strerror(error);
+    switch(error) {
+    case EACCES:
+    case EPERM:
+        s += " (see /proc/sys/kernel/perf_event_paranoid, or run with CAP_PERFMON)";
+        break;
+    case ENOENT:
+    case EOPNOTSUPP:
+        s += " (no such event on this CPU, or no PMU in this virtual machine)";
+        break;
+    case ENOSYS:
+        s += " (perf_event_open is not available)";
+        break;
+    default:
+        break;
+    }
+    return s;
+}
+
+} // namespace
+
+// why() is "names: reason", the events which fail for the same reason
+// being listed together.
+counters::counters()
+{
+    std::string failed;
+    std::string last;
+    for(int e = 0; e < events; ++e) {
+        fd_[e] = open_event(static_cast<event>(e));
+        if(fd_[e] >= 0) {
+            continue;
+        }
+        const std::string r = reason(errno);
+        if(r != last && !failed.empty()) {
+            why_ += (why_.empty() ? "" : "; ") + failed + ": " + last;
+            failed.clear();
+        }
+        failed += (failed.empty() ? "" : ", ") + std::string(event_name(static_cast<event>(e)));
+        last = r;
+    }
+    if(!failed.empty()) {
+        why_ += (why_.empty() ? "" : "; ") + failed + ": " + last;
+    }
+}
+
+counters::~counters()
+{
+    for(int fd : fd_) {
+        if(fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+void counters::start() noexcept
+{
+    for(int fd : fd_) {
+        if(fd >= 0) {
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void counters::stop(double (&values)[events]) noexcept
+{
+    for(int fd : fd_) {
+        if(fd >= 0) {
+            ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for(int e = 0; e < events; ++e) {
+        values[e] = -1;
+        std::uint64_t v[3]; // value, time enabled, time running
+        if(fd_[e] < 0 || ::read(fd_[e], v, sizeof(v)) != static_cast<ssize_t>(sizeof(v)) || v[2] == 0) {
+            continue;
+        }
+        values[e] = static_cast<double>(v[0]) * (static_cast<double>(v[1]) / static_cast<double>(v[2]));
+    }
+}
+
+#else
+
+counters::counters()
+    : why_{"perf_event_open is only available on Linux"}
+{
+    for(int& fd : fd_) {
+        fd = -1;
+    }
+}
+
+counters::~counters() {}
+
+void counters::start() noexcept {}
+
+void counters::stop(double (&values)[events]) noexcept
+{
+    for(double& v : values) {
+        v = -1;
+    }
+}
+
+#endif // defined(__linux__)
+
+bool counters::any() const noexcept
+{
+    for(int fd : fd_) {
+        if(fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace perf
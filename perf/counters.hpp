@@ -0,0 +1,71 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_PERF_COUNTERS_HPP_
+#define NAKATT_PERF_COUNTERS_HPP_
+
+#include <string>
+
+namespace perf {
+
+enum event
+{
+    instructions,
+    branches,
+    branch_misses,
+    l1d_misses,
+    events
+};
+
+const char* event_name(event e) noexcept;
+
+// Hardware counters of the calling thread, in user space only. Each event
+// is opened on its own, so that one the PMU lacks does not take the others
+// with it; if the kernel multiplexes them, the counts are scaled to the
+// whole run. An event which can not be opened is left out, with the reason
+// in why().
+class counters
+{
+public:
+    counters();
+    ~counters();
+
+    counters(const counters&) = delete;
+    counters& operator=(const counters&) = delete;
+
+    bool has(event e) const noexcept { return fd_[e] >= 0; }
+    bool any() const noexcept;
+    const std::string& why() const noexcept { return why_; }
+
+    void start() noexcept;
+
+    // The counts since start(), or a negative value for an event which is
+    // not available or was never scheduled.
+    void stop(double (&values)[events]) noexcept;
+
+private:
+    int fd_[events];
+    std::string why_;
+};
+
+} // namespace perf
+
+#endif // NAKATT_PERF_COUNTERS_HPP_
@@ -0,0 +1,250 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "counters.hpp"
+#include "perf.hpp"
+
+namespace {
+
+struct options
+{
+    std::string filter;
+    std::string out;
+    double scale = 1.0;
+    int repetitions = 5;
+};
+
+// Per operation, the median of the repetitions. A negative count was not
+// measured.
+struct result
+{
+    std::string name;
+    std::uint64_t iterations;
+    double ns_per_op;
+    double per_op[perf::events];
+};
+
+double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    std::size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+result run(const perf::entry& e, const options& opt, perf::counters& c)
+{
+    const std::uint64_t iterations = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(e.iterations * opt.scale));
+    e.fn(iterations / 10 + 1); // warm up the caches and the branch predictors
+
+    std::vector<double> ns;
+    std::vector<double> counts[perf::events];
+    for(int i = 0; i < opt.repetitions; ++i) {
+        double values[perf::events];
+        c.start();
+        auto start = std::chrono::steady_clock::now();
+        e.fn(iterations);
+        auto stop = std::chrono::steady_clock::now();
+        c.stop(values);
+        ns.push_back(std::chrono::duration<double, std::nano>(stop - start).count() / iterations);
+        for(int k = 0; k < perf::events; ++k) {
+            counts[k].push_back(values[k] < 0 ? -1 : values[k] / iterations);
+        }
+    }
+
+    result r{e.name, iterations, median(ns), {}};
+    for(int k = 0; k < perf::events; ++k) {
+        // One repetition the kernel did not schedule makes the event unmeasured.
+        const bool measured = std::none_of(counts[k].begin(), counts[k].end(), [](double v) { return v < 0; });
+        r.per_op[k] = measured ? median(counts[k]) : -1;
+    }
+    return r;
+}
+
+std::string escape(const std::string& s)
+{
+    std::string out;
+    for(char c : s) {
+        if(c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+void print_header()
+{
+    std::printf("%-40s %10s", "name", "ns/op");
+    for(int k = 0; k < perf::events; ++k) {
+        std::printf(" %14s", perf::event_name(static_cast<perf::event>(k)));
+    }
+    std::printf("\n");
+}
+
+void print(const result& r)
+{
+    std::printf("%-40s %10.3f", r.name.c_str(), r.ns_per_op);
+    for(double v : r.per_op) {
+        if(v < 0) {
+            std::printf(" %14s", "-");
+        }
+        else {
+            std::printf(" %14.3f", v);
+        }
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+void write_json(std::ostream& os, const std::vector<result>& results, const options& opt, const perf::counters& c)
+{
+    char buf[64];
+    auto num = [&buf](double v) -> const char* {
+        if(v < 0) {
+            return "null";
+        }
+        std::snprintf(buf, sizeof(buf), "%.4f", v);
+        return buf;
+    };
+
+    os << "{\n";
+    os << "  \"context\": {\n";
+    os << "    \"library\": \"scope-cpp11\",\n";
+    os << "    \"version\": \"" << SCOPE_VERSION << "\",\n";
+#if defined(__VERSION__)
+    os << "    \"compiler\": \"" << escape(__VERSION__) << "\",\n";
+#endif
+    os << "    \"cplusplus\": " << __cplusplus << ",\n";
+    os << "    \"repetitions\": " << opt.repetitions << ",\n";
+    os << "    \"counters_unavailable\": \"" << escape(c.why()) << "\"\n";
+    os << "  },\n";
+    os << "  \"benchmarks\": [";
+    for(std::size_t i = 0; i < results.size(); ++i) {
+        const result& r = results[i];
+        os << (i ? ",\n" : "\n");
+        os << "    {\n";
+        os << "      \"name\": \"" << escape(r.name) << "\",\n";
+        os << "      \"iterations\": " << r.iterations << ",\n";
+        os << "      \"ns_per_op\": " << num(r.ns_per_op);
+        for(int k = 0; k < perf::events; ++k) {
+            os << ",\n      \"" << perf::event_name(static_cast<perf::event>(k)) << "_per_op\": " << num(r.per_op[k]);
+        }
+        os << "\n    }";
+    }
+    os << "\n  ]\n";
+    os << "}\n";
+}
+
+bool parse_option(const char* arg, const char* name, std::string& value)
+{
+    std::size_t len = std::strlen(name);
+    if(std::strncmp(arg, name, len) == 0 && arg[len] == '=') {
+        value = arg + len + 1;
+        return true;
+    }
+    return false;
+}
+
+void usage(const char* argv0)
+{
+    std::cerr << "usage: " << argv0 << " [--filter=<substring>] [--scale=<iterations factor>] [--repetitions=<n>] [--out=<file>] [--list]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    options opt;
+    bool list = false;
+    for(int i = 1; i < argc; ++i) {
+        std::string value;
+        if(parse_option(argv[i], "--filter", value)) {
+            opt.filter = value;
+        }
+        else if(parse_option(argv[i], "--out", value)) {
+            opt.out = value;
+        }
+        else if(parse_option(argv[i], "--scale", value)) {
+            opt.scale = std::atof(value.c_str());
+        }
+        else if(parse_option(argv[i], "--repetitions", value)) {
+            opt.repetitions = std::max(1, std::atoi(value.c_str()));
+        }
+        else if(std::strcmp(argv[i], "--list") == 0) {
+            list = true;
+        }
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<perf::entry> entries;
+    for(const auto& e : perf::registry()) {
+        if(opt.filter.empty() || std::strstr(e.name, opt.filter.c_str())) {
+            entries.push_back(e);
+        }
+    }
+    if(list) {
+        for(const auto& e : entries) {
+            std::cout << e.name << "\n";
+        }
+        return 0;
+    }
+
+    // Without counters the harness still reports ns/op.
+    perf::counters c;
+    if(!c.why().empty()) {
+        std::cerr << (c.any() ? "some hardware counters are unavailable: " : "hardware counters are unavailable, reporting ns/op only: ")
+                  << c.why() << "\n";
+    }
+
+    std::vector<result> results;
+    print_header();
+    for(const auto& e : entries) {
+        results.push_back(run(e, opt, c));
+        print(results.back());
+    }
+
+    if(!opt.out.empty()) {
+        std::ofstream ofs{opt.out};
+        if(!ofs) {
+            std::cerr << "cannot write " << opt.out << "\n";
+            return 1;
+        }
+        write_json(ofs, results, opt, c);
+    }
+    return 0;
+}
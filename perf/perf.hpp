@@ -0,0 +1,70 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_PERF_HPP_
+#define NAKATT_PERF_HPP_
+
+#include <cstdint>
+#include <vector>
+
+namespace perf {
+
+// Keep `value` alive in a register or memory so that the optimizer can not
+// delete the computation which produced it.
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobber_memory()
+{
+    asm volatile("" : : : "memory");
+}
+
+// A case runs its operation `iterations` times; the counters are enabled
+// around the call, so the loop is all it should do.
+using function = void (*)(std::uint64_t iterations);
+
+struct entry
+{
+    const char* name;
+    function fn;
+    std::uint64_t iterations;
+};
+
+inline std::vector<entry>& registry()
+{
+    static std::vector<entry> entries;
+    return entries;
+}
+
+struct registrar
+{
+    registrar(const char* name, function fn, std::uint64_t iterations)
+    {
+        registry().push_back(entry{name, fn, iterations});
+    }
+};
+
+} // namespace perf
+
+#endif // NAKATT_PERF_HPP_
@@ -26,6 +26,7 @@
 #include <catch2/catch.hpp>
 
 #if defined(SCOPE_USE_SUCCESS_FAIL) && defined(SCOPE_USE_DEDUCTION_GUIDE)
+#if !defined(SCOPE_NO_EXCEPTIONS)
 TEST_CASE("standard paper p0052 demo")
 {
     using namespace scope;
@@ -42,6 +43,7 @@ TEST_CASE("standard paper p0052 demo")
     }
     REQUIRE("called always handled" == out.str());
 }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 #endif // defined(SCOPE_USE_SUCCESS_FAIL) && defined(SCOPE_USE_DEDUCTION_GUIDE)
 
 TEST_CASE("scope_exit called on destruction")
@@ -69,6 +71,7 @@ TEST_CASE("you can use make_scope_exit() instead in C++11/14")
 
 #if defined(SCOPE_USE_SUCCESS_FAIL)
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
 TEST_CASE("scope_success called on destruction, not called on exception")
 {
     int x = 0;
@@ -112,5 +115,6 @@ TEST_CASE("scope_fail not called on destruction, called on exception")
         REQUIRE(x == 1);
     }
 }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 
 #endif // defined(SCOPE_USE_SUCCESS_FAIL)
@@ -43,6 +43,7 @@ TEST_CASE("scope_guard (scope_guard && rhs): noexpect if is_nothrow_move_constru
     REQUIRE(std::is_nothrow_move_constructible<scope::scope_exit<void_func_t>>::value);
 }
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
 TEST_CASE("scope_guard (scope_guard && rhs): noexpect if is_nothrow_copy_constructible_v<EF>")
 {
     struct EF
@@ -75,6 +76,7 @@ TEST_CASE("scope_guard (scope_guard && rhs): Any exception thrown during the ini
         REQUIRE(false);
     }
 }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 
 TEST_CASE("release(): Equivalent to execute_on_destruction = false.")
 {
@@ -100,6 +100,7 @@ TEST_CASE("scope_exit::release()")
     REQUIRE(x == 0);
 }
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
 TEST_CASE("released scope_guard does not call exit_function")
 {
     int x = 0;
@@ -110,6 +111,7 @@ TEST_CASE("released scope_guard does not call exit_function")
     }
     REQUIRE(x == 1);
 }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 
 TEST_CASE("scope_exit::scope_exit(EFP&& f): noexcept if is_nothrow_constructible_v<EF, EFP> || is_nothrow_constructible_v<EF, EFP&>")
 {
@@ -117,6 +119,7 @@ TEST_CASE("scope_exit::scope_exit(EFP&& f): noexcept if is_nothrow_constructible
     REQUIRE(std::is_nothrow_constructible<scope::scope_exit<void_func_t>, void_func_t&>::value);
 }
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
 TEST_CASE("scope_exit::scope_exit(EFP&& f): If the initialization of exit_function throws an exception, calls f().")
 {
     value_of_func = 0;
@@ -131,6 +134,7 @@ TEST_CASE("scope_exit::scope_exit(EFP&& f): If the initialization of exit_functi
         REQUIRE(false);
     }
 }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 
 TEST_CASE("~scope_exit() is noexcept")
 {
@@ -109,6 +109,7 @@ TEST_CASE("scope_success::scope_success(EFP&& f): noexcept if is_nothrow_constru
     REQUIRE(std::is_nothrow_constructible<scope::scope_success<void_func_t>, void_func_t&>::value);
 }
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
 TEST_CASE("scope_success::scope_success(EFP&& f): If the initialization of exit_function throws an exception, don't call f().")
 {
     value_of_func = 0;
@@ -123,12 +124,14 @@ TEST_CASE("scope_success::scope_success(EFP&& f): If the initialization of exit_
         REQUIRE(false);
     }
 }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 
 TEST_CASE("~scope_success() is noexcept if noexcept(exit_function())")
 {
     REQUIRE(std::is_nothrow_destructible<scope::scope_exit<void_func_t>>::value);
 }
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
 TEST_CASE("~scope_success() is not noexcept if not noexcept(exit_function())")
 {
     struct EF
@@ -159,6 +162,7 @@ TEST_CASE("~scope_success(): any exception thrown by exit_function().")
     }
     REQUIRE(x == 1);
 }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 
 #if defined(SCOPE_USE_DEDUCTION_GUIDE)
 TEST_CASE("scope_success deduction guide")
@@ -173,6 +177,7 @@ TEST_CASE("scope_success deduction guide")
         REQUIRE(x == 2);
     }
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
     SECTION("block failed on exception") {
         try {
             scope::scope_success g1{[&]{ ++x; }};
@@ -183,6 +188,7 @@ TEST_CASE("scope_success deduction guide")
         }
         REQUIRE(x == 0);
     }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 }
 #endif
 
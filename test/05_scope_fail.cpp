@@ -30,6 +30,7 @@ using namespace helper;
 
 #if defined(SCOPE_USE_SUCCESS_FAIL)
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
 TEST_CASE("scope_fail accepts function like object")
 {
     SECTION("function pointer") {
@@ -126,6 +127,7 @@ TEST_CASE("scope_fail::release()")
     }
     REQUIRE(x == 0);
 }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 
 TEST_CASE("scope_fail::scope_fail(EFP&& f): noexcept if is_nothrow_constructible_v<EF, EFP> || is_nothrow_constructible_v<EF, EFP&>")
 {
@@ -133,6 +135,7 @@ TEST_CASE("scope_fail::scope_fail(EFP&& f): noexcept if is_nothrow_constructible
     REQUIRE(std::is_nothrow_constructible<scope::scope_fail<void_func_t>, void_func_t&>::value);
 }
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
 TEST_CASE("scope_fail::scope_fail(EFP&& f): If the initialization of exit_function throws an exception, calls f().")
 {
     value_of_func = 0;
@@ -147,6 +150,7 @@ TEST_CASE("scope_fail::scope_fail(EFP&& f): If the initialization of exit_functi
         REQUIRE(false);
     }
 }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 
 TEST_CASE("~scope_fail() is noexcept")
 {
@@ -166,6 +170,7 @@ TEST_CASE("scope_fail deduction guide")
         REQUIRE(x == 0);
     }
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
     SECTION("block failed on exception") {
         try {
             scope::scope_fail g1{[&]{ ++x; }};
@@ -176,6 +181,7 @@ TEST_CASE("scope_fail deduction guide")
         }
         REQUIRE(x == 2);
     }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 }
 #endif
 
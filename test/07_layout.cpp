@@ -0,0 +1,140 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <type_traits>
+
+#include <catch2/catch.hpp>
+#include "helper.hpp"
+
+using namespace helper;
+
+namespace {
+
+auto stateless_lambda = []() noexcept {};
+
+struct empty_functor
+{
+    void operator()() const noexcept {}
+};
+
+struct final_functor final
+{
+    void operator()() const noexcept {}
+};
+
+struct pointer_functor
+{
+    int* p;
+    void operator()() const noexcept { ++*p; }
+};
+
+} // namespace
+
+// An empty exit function takes no space, the armed flag is the only member.
+static_assert(sizeof(scope::scope_exit<decltype(stateless_lambda)>) == 1, "");
+static_assert(sizeof(scope::scope_exit<empty_functor>) == 1, "");
+#if defined(SCOPE_IS_FINAL)
+static_assert(sizeof(scope::scope_exit<final_functor>) == 2, "");
+#endif
+
+// A non-empty exit function is followed by the armed flag and padding only.
+static_assert(sizeof(scope::scope_exit<pointer_functor>) == 2 * sizeof(void*), "");
+static_assert(sizeof(scope::scope_exit<void_func_t>) == 2 * sizeof(void*), "");
+static_assert(sizeof(scope::scope_exit<empty_functor&>) == 2 * sizeof(void*), "");
+
+#if defined(SCOPE_NO_EXCEPTIONS)
+// Without exceptions scope_success and scope_fail are laid out as scope_exit.
+static_assert(sizeof(scope::scope_success<decltype(stateless_lambda)>) == 1, "");
+static_assert(sizeof(scope::scope_success<pointer_functor>) == 2 * sizeof(void*), "");
+static_assert(sizeof(scope::scope_fail<decltype(stateless_lambda)>) == 1, "");
+static_assert(sizeof(scope::scope_fail<pointer_functor>) == 2 * sizeof(void*), "");
+#elif defined(SCOPE_USE_SUCCESS_FAIL)
+// scope_success and scope_fail keep the armed flag in the uncaught exception count.
+static_assert(sizeof(scope::scope_success<decltype(stateless_lambda)>) == sizeof(int), "");
+static_assert(sizeof(scope::scope_success<empty_functor>) == sizeof(int), "");
+static_assert(sizeof(scope::scope_success<pointer_functor>) == 2 * sizeof(void*), "");
+static_assert(sizeof(scope::scope_success<void_func_t>) == 2 * sizeof(void*), "");
+
+static_assert(sizeof(scope::scope_fail<decltype(stateless_lambda)>) == sizeof(int), "");
+static_assert(sizeof(scope::scope_fail<empty_functor>) == sizeof(int), "");
+static_assert(sizeof(scope::scope_fail<pointer_functor>) == 2 * sizeof(void*), "");
+static_assert(sizeof(scope::scope_fail<void_func_t>) == 2 * sizeof(void*), "");
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+
+TEST_CASE("scope_exit with an empty exit function is called on destruction")
+{
+    Functor::value = 0;
+    {
+        auto g = scope::make_scope_exit(Functor{});
+        auto g2{std::move(g)};
+    }
+    REQUIRE(Functor::value == 1);
+}
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+
+TEST_CASE("released scope_success is not called after move")
+{
+    int x = 0;
+    {
+        auto g = scope::make_scope_success(pointer_functor{&x});
+        g.release();
+        auto g2{std::move(g)};
+    }
+    REQUIRE(x == 0);
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("moved-from scope_fail is not called on exception")
+{
+    int x = 0;
+    try {
+        auto g = scope::make_scope_fail(pointer_functor{&x});
+        auto g2{std::move(g)};
+        throw 42;
+    }
+    catch(...) {
+    }
+    REQUIRE(x == 1);
+}
+
+TEST_CASE("scope_fail released inside a catch block is not called on a nested exception")
+{
+    int x = 0;
+    try {
+        throw 1;
+    }
+    catch(...) {
+        try {
+            auto g = scope::make_scope_fail(pointer_functor{&x});
+            g.release();
+            throw 2;
+        }
+        catch(...) {
+        }
+    }
+    REQUIRE(x == 0);
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
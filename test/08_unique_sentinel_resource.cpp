@@ -0,0 +1,177 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <cstdio>
+#include <type_traits>
+#include <utility>
+
+#include <catch2/catch.hpp>
+#include "helper.hpp"
+
+using namespace helper;
+
+namespace {
+
+int closed_fd = 0;
+int close_count = 0;
+
+struct close_fd
+{
+    void operator()(int fd) const noexcept
+    {
+        closed_fd = fd;
+        ++close_count;
+    }
+};
+
+using fd_traits = scope::sentinel_traits<int, -1>;
+using unique_fd = scope::unique_sentinel_resource<int, close_fd, fd_traits>;
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+struct BadDeleter
+{
+    BadDeleter() noexcept {}
+    BadDeleter(const BadDeleter&) { throw TestException(); }
+    void operator()(int fd) const noexcept { closed_fd = fd; ++close_count; }
+};
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+void reset_counters()
+{
+    closed_fd = 0;
+    close_count = 0;
+}
+
+} // namespace
+
+static_assert(sizeof(unique_fd) == sizeof(int), "");
+static_assert(sizeof(unique_fd[16]) == 16 * sizeof(int), "");
+static_assert(sizeof(scope::unique_sentinel_resource<FILE*, int (*)(FILE*), scope::sentinel_traits<FILE*, nullptr>>) == 2 * sizeof(void*), "");
+static_assert(std::is_nothrow_move_constructible<unique_fd>::value, "");
+static_assert(std::is_nothrow_move_assignable<unique_fd>::value, "");
+
+TEST_CASE("unique_sentinel_resource calls the deleter on destruction")
+{
+    reset_counters();
+    {
+        unique_fd fd{3, close_fd{}};
+        REQUIRE(fd.get() == 3);
+    }
+    REQUIRE(closed_fd == 3);
+    REQUIRE(close_count == 1);
+}
+
+TEST_CASE("unique_sentinel_resource does not own the invalid value")
+{
+    reset_counters();
+    {
+        unique_fd fd{-1, close_fd{}};
+        unique_fd fd2;
+        REQUIRE(fd.get() == -1);
+        REQUIRE(fd2.get() == -1);
+    }
+    REQUIRE(close_count == 0);
+}
+
+TEST_CASE("unique_sentinel_resource::release() returns the resource and stores the invalid value")
+{
+    reset_counters();
+    {
+        auto fd = scope::make_unique_sentinel_resource<fd_traits>(4, close_fd{});
+        REQUIRE(fd.release() == 4);
+        REQUIRE(fd.get() == -1);
+    }
+    REQUIRE(close_count == 0);
+}
+
+TEST_CASE("unique_sentinel_resource::reset()")
+{
+    reset_counters();
+    unique_fd fd{5, close_fd{}};
+
+    SECTION("reset() deletes once") {
+        fd.reset();
+        fd.reset();
+        REQUIRE(closed_fd == 5);
+        REQUIRE(close_count == 1);
+        REQUIRE(fd.get() == -1);
+    }
+
+    SECTION("reset(r) deletes the old resource and owns the new one") {
+        fd.reset(6);
+        REQUIRE(closed_fd == 5);
+        REQUIRE(close_count == 1);
+        REQUIRE(fd.get() == 6);
+        fd.reset(-1);
+        REQUIRE(closed_fd == 6);
+        REQUIRE(close_count == 2);
+    }
+}
+
+TEST_CASE("unique_sentinel_resource move construction and assignment transfer ownership")
+{
+    reset_counters();
+    {
+        unique_fd fd{7, close_fd{}};
+        unique_fd fd2{std::move(fd)};
+        REQUIRE(fd.get() == -1);
+        REQUIRE(fd2.get() == 7);
+
+        unique_fd fd3{8, close_fd{}};
+        fd3 = std::move(fd2);
+        REQUIRE(closed_fd == 8);
+        REQUIRE(close_count == 1);
+        REQUIRE(fd2.get() == -1);
+        REQUIRE(fd3.get() == 7);
+    }
+    REQUIRE(closed_fd == 7);
+    REQUIRE(close_count == 2);
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("unique_sentinel_resource deletes the resource if copying the deleter throws")
+{
+    reset_counters();
+    BadDeleter d;
+    try {
+        scope::unique_sentinel_resource<int, BadDeleter, fd_traits> fd{9, d}; // throw exception
+        REQUIRE(false); // not reached
+    }
+    catch(TestException&) {
+        REQUIRE(closed_fd == 9);
+        REQUIRE(close_count == 1);
+    }
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+TEST_CASE("unique_sentinel_resource supports pointer resources")
+{
+    int x = 42;
+    int deleted = 0;
+    {
+        auto deleter = [&deleted](int*) { ++deleted; };
+        auto p = scope::make_unique_sentinel_resource<scope::sentinel_traits<int*, nullptr>>(&x, deleter);
+        REQUIRE(*p == 42);
+    }
+    REQUIRE(deleted == 1);
+}
@@ -0,0 +1,92 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+int closed = 0;
+
+void close_handle(int h) noexcept { closed = h; }
+void close_handle_may_throw(int h) { closed = h; }
+void free_int(int* p) noexcept { delete p; }
+
+using close_handle_deleter = SCOPE_STATIC_DELETER(close_handle);
+
+} // namespace
+
+static_assert(std::is_empty<close_handle_deleter>::value, "");
+static_assert(noexcept(close_handle_deleter{}(1)), "");
+static_assert(!noexcept(SCOPE_STATIC_DELETER(close_handle_may_throw){}(1)), "");
+
+// The deleter takes no space, unlike a function pointer.
+static_assert(sizeof(scope::unique_resource<int*, SCOPE_STATIC_DELETER(free_int)>) == 2 * sizeof(void*), "");
+static_assert(sizeof(scope::unique_resource<int*, void (*)(int*)>) == 3 * sizeof(void*), "");
+static_assert(sizeof(scope::unique_sentinel_resource<int, close_handle_deleter, scope::sentinel_traits<int, -1>>) == sizeof(int), "");
+
+TEST_CASE("basic_static_deleter calls the function")
+{
+    closed = 0;
+    {
+        auto r = scope::make_unique_resource(42, close_handle_deleter{});
+    }
+    REQUIRE(closed == 42);
+}
+
+TEST_CASE("basic_static_deleter with make_unique_resource_checked")
+{
+    closed = 0;
+    {
+        auto r = scope::make_unique_resource_checked(-1, -1, close_handle_deleter{});
+    }
+    REQUIRE(closed == 0);
+}
+
+#if defined(SCOPE_USE_STATIC_DELETER)
+TEST_CASE("static_deleter takes the address of fclose")
+{
+    const std::string filename = "static_deleter.txt";
+    {
+        auto file = scope::make_unique_resource(::fopen(filename.c_str(), "w"), scope::static_deleter<&::fclose>{});
+        REQUIRE(file.get() != NULL);
+        ::fputs("Hello World!\n", file.get());
+        static_assert(sizeof(file) == 2 * sizeof(void*), "");
+    }
+    {
+        std::ifstream input{filename};
+        std::string line{};
+        getline(input, line);
+        REQUIRE("Hello World!" == line);
+    }
+    ::remove(filename.c_str());
+    {
+        auto file = scope::make_unique_resource_checked(::fopen("nonexistingfile.txt", "r"), (FILE*)NULL, scope::static_deleter<&::fclose>{});
+        REQUIRE(file.get() == NULL);
+    }
+}
+#endif // defined(SCOPE_USE_STATIC_DELETER)
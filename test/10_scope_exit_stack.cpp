@@ -0,0 +1,184 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include "helper.hpp"
+
+using namespace helper;
+
+TEST_CASE("scope_exit_stack calls exit functions in reverse order")
+{
+    std::string out;
+    {
+        scope::scope_exit_stack<> stack;
+        for(char c = 'a'; c <= 'e'; ++c) {
+            stack.push([&out, c]{ out += c; });
+        }
+        REQUIRE(stack.size() == 5);
+    }
+    REQUIRE(out == "edcba");
+}
+
+TEST_CASE("scope_exit_stack moves to the heap beyond N exit functions")
+{
+    std::vector<int> out;
+    {
+        scope::scope_exit_stack<2> stack;
+        for(int i = 0; i < 100; ++i) {
+            stack.push([&out, i]{ out.push_back(i); });
+        }
+    }
+    REQUIRE(out.size() == 100);
+    for(int i = 0; i < 100; ++i) {
+        REQUIRE(out[i] == 99 - i);
+    }
+}
+
+TEST_CASE("scope_exit_stack accepts exit functions of any size")
+{
+    std::string out;
+    {
+        scope::scope_exit_stack<2> stack;
+        std::string big(64, 'x');
+        auto shared = std::make_shared<int>(1);
+        stack.push([&out, big]{ out += big; });
+        stack.push([&out, shared]{ out += std::to_string(*shared); });
+        stack.push(func);
+        value_of_func = 0;
+    }
+    REQUIRE(out == "1" + std::string(64, 'x'));
+    REQUIRE(value_of_func == 1);
+}
+
+TEST_CASE("scope_exit_stack::release(handle) drops one exit function")
+{
+    std::string out;
+    {
+        scope::scope_exit_stack<> stack;
+        stack.push([&]{ out += 'a'; });
+        auto h = stack.push([&]{ out += 'b'; });
+        auto h2 = stack.push([&]{ out += 'c'; });
+        stack.release(h);
+        stack.release(h2);
+        REQUIRE(stack.size() == 1);
+        stack.push([&]{ out += 'd'; });
+    }
+    REQUIRE(out == "da");
+}
+
+TEST_CASE("scope_exit_stack::release() drops all exit functions")
+{
+    int x = 0;
+    auto counter = std::make_shared<int>(0);
+    {
+        scope::scope_exit_stack<> stack;
+        stack.push([&x, counter]{ ++x; });
+        stack.push([&x, counter]{ ++x; });
+        REQUIRE(counter.use_count() == 3);
+        stack.release();
+        REQUIRE(stack.empty());
+        REQUIRE(counter.use_count() == 1);
+        stack.push([&x]{ x += 10; });
+    }
+    REQUIRE(x == 10);
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("scope_exit_stack::push(): If the exit function can not be stored, calls f()")
+{
+    struct ThrowOnCopy
+    {
+        ThrowOnCopy() noexcept {}
+        ThrowOnCopy(const ThrowOnCopy&) { throw TestException(); }
+        void operator()() const noexcept { value_of_func++; }
+    };
+    value_of_func = 0;
+    try {
+        scope::scope_exit_stack<> stack;
+        ThrowOnCopy f;
+        stack.push(f); // throw exception
+        REQUIRE(false); // not reached
+    }
+    catch(TestException&) {
+        REQUIRE(value_of_func == 1);
+    }
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+
+TEST_CASE("scope_success_stack and scope_fail_stack")
+{
+    std::string out;
+
+    SECTION("block finished successfully") {
+        {
+            scope::scope_success_stack<> success;
+            scope::scope_fail_stack<> fail;
+            success.push([&]{ out += 's'; });
+            fail.push([&]{ out += 'f'; });
+        }
+        REQUIRE(out == "s");
+    }
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+    SECTION("block failed on exception") {
+        try {
+            scope::scope_success_stack<> success;
+            scope::scope_fail_stack<> fail;
+            success.push([&]{ out += 's'; });
+            fail.push([&]{ out += 'f'; });
+            fail.push([&]{ out += 'g'; });
+            throw 42;
+        }
+        catch(...) {
+        }
+        REQUIRE(out == "gf");
+    }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("scope_success_stack lets an exception of an exit function escape and drops the rest")
+{
+    static_assert(!std::is_nothrow_destructible<scope::scope_success_stack<>>::value, "");
+    static_assert(std::is_nothrow_destructible<scope::scope_fail_stack<>>::value, "");
+
+    std::string out;
+    auto p = std::make_shared<int>(0);
+    REQUIRE_THROWS_AS([&]{
+        scope::scope_success_stack<> stack;
+        stack.push([&out, p]{ out += 'a'; });
+        stack.push([&out]{ out += 'b'; throw TestException{}; });
+        stack.push([&out, p]{ out += 'c'; });
+    }(), TestException);
+    REQUIRE(out == "cb");
+    REQUIRE(p.use_count() == 1);
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
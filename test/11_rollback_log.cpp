@@ -0,0 +1,110 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("rollback_log rolls back in reverse order on destruction")
+{
+    std::vector<int> v;
+    {
+        scope::rollback_log<> log;
+        for(int i = 0; i < 3; ++i) {
+            v.push_back(i);
+            log.push([&v]{ v.pop_back(); });
+        }
+        v[1] = 42;
+        log.push([&v]{ v[1] = 1; });
+        REQUIRE(v == (std::vector<int>{0, 42, 2}));
+    }
+    REQUIRE(v.empty());
+}
+
+TEST_CASE("rollback_log::commit() drops all undo actions")
+{
+    int x = 0;
+    {
+        scope::rollback_log<> log;
+        x = 1;
+        log.push([&x]{ x = 0; });
+        log.commit();
+        REQUIRE(log.empty());
+    }
+    REQUIRE(x == 1);
+}
+
+TEST_CASE("rollback_log::rollback() calls undo actions once")
+{
+    std::string out;
+    scope::rollback_log<> log;
+    log.push([&out]{ out += 'a'; });
+    log.push([&out]{ out += 'b'; });
+    log.rollback();
+    log.rollback();
+    REQUIRE(out == "ba");
+    REQUIRE(log.empty());
+}
+
+TEST_CASE("rollback_log nested savepoints")
+{
+    std::string out;
+    {
+        scope::rollback_log<> log;
+        log.push([&out]{ out += 'a'; });
+        auto outer = log.mark();
+        log.push([&out]{ out += 'b'; });
+        auto inner = log.mark();
+        log.push([&out]{ out += 'c'; });
+        log.push([&out]{ out += 'd'; });
+
+        log.rollback_to(inner);
+        REQUIRE(out == "dc");
+
+        log.push([&out]{ out += 'e'; });
+        log.rollback_to(outer);
+        REQUIRE(out == "dceb");
+    }
+    REQUIRE(out == "dceba");
+}
+
+TEST_CASE("rollback_log moves to the heap beyond its inline buffer")
+{
+    std::vector<int> out;
+    {
+        scope::rollback_log<32> log;
+        for(int i = 0; i < 100; ++i) {
+            const int a = i, b = i * 2, c = i * 3;
+            log.push([&out, a, b, c]{ out.push_back(a + b + c); });
+        }
+        auto sp = log.mark();
+        log.push([&out]{ out.push_back(-1); });
+        log.rollback_to(sp);
+        REQUIRE(out == std::vector<int>{-1});
+    }
+    REQUIRE(out.size() == 101);
+    for(int i = 0; i < 100; ++i) {
+        REQUIRE(out[i + 1] == (99 - i) * 6);
+    }
+}
@@ -0,0 +1,134 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <string>
+
+#include <catch2/catch.hpp>
+#include "helper.hpp"
+
+using namespace helper;
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+
+TEST_CASE("scope_transaction calls exit and success actions when the block finished successfully")
+{
+    std::string out;
+    {
+        scope::scope_transaction<> t;
+        t.on_exit([&]{ out += 'e'; });
+        t.on_success([&]{ out += 's'; });
+        t.on_fail([&]{ out += 'f'; });
+        t.on_success([&]{ out += 't'; });
+        REQUIRE(t.size() == 4);
+    }
+    REQUIRE(out == "tse");
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("scope_transaction calls exit and fail actions on exception")
+{
+    std::string out;
+    try {
+        scope::scope_transaction<> t;
+        t.on_exit([&]{ out += 'e'; });
+        t.on_success([&]{ out += 's'; });
+        t.on_fail([&]{ out += 'f'; });
+        t.on_fail([&]{ out += 'g'; });
+        throw 42;
+    }
+    catch(...) {
+    }
+    REQUIRE(out == "gfe");
+}
+
+TEST_CASE("scope_transaction created while handling an exception")
+{
+    std::string out;
+    try {
+        throw 1;
+    }
+    catch(...) {
+        scope::scope_transaction<> t;
+        t.on_success([&]{ out += 's'; });
+        t.on_fail([&]{ out += 'f'; });
+    }
+    REQUIRE(out == "s");
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+TEST_CASE("scope_transaction::release()")
+{
+    std::string out;
+    {
+        scope::scope_transaction<2> t;
+        t.on_success([&]{ out += 'a'; });
+        auto h = t.on_success([&]{ out += 'b'; });
+        t.on_exit([&]{ out += 'c'; });
+        t.release(h);
+        REQUIRE(t.size() == 2);
+    }
+    REQUIRE(out == "ca");
+
+    out.clear();
+    {
+        scope::scope_transaction<> t;
+        t.on_success([&]{ out += 'a'; });
+        t.release();
+        REQUIRE(t.empty());
+    }
+    REQUIRE(out.empty());
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("scope_transaction: If the action can not be stored, calls f() as the scope guard would")
+{
+    struct ThrowOnCopy
+    {
+        ThrowOnCopy() noexcept {}
+        ThrowOnCopy(const ThrowOnCopy&) { throw TestException(); }
+        void operator()() const noexcept { value_of_func++; }
+    };
+    ThrowOnCopy f;
+
+    value_of_func = 0;
+    try {
+        scope::scope_transaction<> t;
+        t.on_success(f); // throw exception
+        REQUIRE(false); // not reached
+    }
+    catch(TestException&) {
+        REQUIRE(value_of_func == 0);
+    }
+
+    try {
+        scope::scope_transaction<> t;
+        t.on_fail(f); // throw exception
+        REQUIRE(false); // not reached
+    }
+    catch(TestException&) {
+        REQUIRE(value_of_func == 1);
+    }
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
@@ -0,0 +1,216 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/reaper.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+struct record_thread
+{
+    std::vector<std::thread::id>* ids;
+    void operator()(int i) const noexcept { (*ids)[i] = std::this_thread::get_id(); }
+};
+
+} // namespace
+
+TEST_CASE("deferred_deleter deletes on the reaper thread")
+{
+    std::vector<std::thread::id> ids(4);
+    scope::reaper r;
+    {
+        scope::deferred_deleter<record_thread> d{record_thread{&ids}, r};
+        scope::unique_resource<int, scope::deferred_deleter<record_thread>> u0{0, d};
+        scope::unique_resource<int, scope::deferred_deleter<record_thread>> u1{1, d};
+        u1.reset(2);
+        auto u3 = scope::make_unique_resource_checked(3, 3, d);
+    }
+    r.flush();
+    REQUIRE(r.pending() == 0);
+    REQUIRE(ids[0] != std::this_thread::get_id());
+    REQUIRE(ids[0] != std::thread::id{});
+    REQUIRE(ids[1] == ids[0]);
+    REQUIRE(ids[2] == ids[0]);
+    REQUIRE(ids[3] == std::thread::id{}); // not owned
+}
+
+TEST_CASE("reaper runs every posted job before it is destroyed")
+{
+    std::atomic<int> count{0};
+    {
+        scope::reaper r{8};
+        for(int i = 0; i < 100; ++i) {
+            r.post([&count]{ ++count; });
+        }
+    }
+    REQUIRE(count == 100);
+}
+
+TEST_CASE("reaper overflow policy")
+{
+    std::atomic<bool> started{false};
+    std::atomic<bool> go{false};
+    auto blocker = [&]{
+        started = true;
+        while(!go) {
+            std::this_thread::yield();
+        }
+    };
+    std::vector<std::thread::id> ids(4);
+
+    SECTION("run_inline") {
+        scope::reaper r{4, scope::reaper_overflow::run_inline};
+        r.post(blocker);
+        while(!started) {
+            std::this_thread::yield();
+        }
+        // The blocker holds its cell until it returns.
+        for(int i = 0; i < 4; ++i) {
+            r.post([&ids, i]{ ids[i] = std::this_thread::get_id(); });
+        }
+        REQUIRE(ids[3] == std::this_thread::get_id());
+        REQUIRE(ids[0] == std::thread::id{});
+        go = true;
+        r.flush();
+        REQUIRE(ids[0] != std::this_thread::get_id());
+        REQUIRE(ids[0] != std::thread::id{});
+        REQUIRE(ids[2] == ids[0]);
+    }
+
+    SECTION("block") {
+        scope::reaper r{4, scope::reaper_overflow::block};
+        r.post(blocker);
+        while(!started) {
+            std::this_thread::yield();
+        }
+        std::thread release{[&]{
+            while(r.pending() < 4) {
+                std::this_thread::yield();
+            }
+            go = true;
+        }};
+        for(int i = 0; i < 4; ++i) {
+            r.post([&ids, i]{ ids[i] = std::this_thread::get_id(); });
+        }
+        release.join();
+        r.flush();
+        for(auto id : ids) {
+            REQUIRE(id != std::this_thread::get_id());
+            REQUIRE(id != std::thread::id{});
+        }
+    }
+}
+
+TEST_CASE("reaper::drain() runs the queued jobs on the calling thread")
+{
+    std::atomic<bool> started{false};
+    std::atomic<bool> go{false};
+    std::vector<std::thread::id> ids(2);
+    scope::reaper r;
+    r.post([&]{
+        started = true;
+        while(!go) {
+            std::this_thread::yield();
+        }
+    });
+    while(!started) {
+        std::this_thread::yield();
+    }
+    r.post([&ids]{ ids[0] = std::this_thread::get_id(); });
+    r.post([&ids]{ ids[1] = std::this_thread::get_id(); });
+    std::thread release{[&]{
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        go = true;
+    }};
+    // Waits for the running job, then runs the others unless the reaper
+    // thread took them first.
+    r.drain();
+    release.join();
+    REQUIRE(r.pending() == 0);
+    REQUIRE(ids[0] != std::thread::id{});
+    REQUIRE(ids[1] != std::thread::id{});
+}
+
+TEST_CASE("reaper moves a job which does not fit in a queue cell to the heap")
+{
+    std::thread::id id;
+    char big[64] = {};
+    scope::reaper r;
+    r.post([&id, big]{ id = std::this_thread::get_id(); (void)big; });
+    r.flush();
+    REQUIRE(id != std::this_thread::get_id());
+    REQUIRE(id != std::thread::id{});
+}
+
+TEST_CASE("an idle reaper is woken up by post()")
+{
+    std::atomic<bool> called{false};
+    scope::reaper r{16, scope::reaper_overflow::run_inline, std::chrono::microseconds(100)};
+    // Long enough for the reaper thread to go idle.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    r.post([&called]{ called = true; });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(!called && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    REQUIRE(called);
+}
+
+TEST_CASE("reaper::flush() and reaper::drain() called from a job return at once")
+{
+    std::atomic<int> count{0};
+    scope::reaper r;
+    r.post([&]{
+        r.post([&count]{ ++count; });
+        r.flush();
+        r.drain();
+        ++count;
+    });
+    r.flush();
+    REQUIRE(count >= 1);
+    r.flush();
+    REQUIRE(count == 2);
+}
+
+TEST_CASE("reaper with concurrent producers")
+{
+    std::atomic<int> count{0};
+    scope::reaper r{16, scope::reaper_overflow::block};
+    std::vector<std::thread> producers;
+    for(int t = 0; t < 4; ++t) {
+        producers.emplace_back([&]{
+            for(int i = 0; i < 1000; ++i) {
+                r.post([&count]{ ++count; });
+            }
+        });
+    }
+    for(auto& t : producers) {
+        t.join();
+    }
+    r.flush();
+    REQUIRE(count == 4000);
+}
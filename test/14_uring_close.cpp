@@ -0,0 +1,102 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/uring_close.hpp"
+
+#if defined(__unix__)
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+bool is_open(int fd)
+{
+    return ::fcntl(fd, F_GETFD) != -1;
+}
+
+int new_fd()
+{
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+    ::close(fds[1]);
+    return fds[0];
+}
+
+} // namespace
+
+TEST_CASE("uring_close closes the fd when the batch is flushed")
+{
+    int fd = new_fd();
+    {
+        scope::unique_resource<int, scope::uring_close> u{fd, scope::uring_close{}};
+    }
+    if(scope::uring_close_available()) {
+        REQUIRE(scope::uring_close_pending() == 1);
+        REQUIRE(is_open(fd));
+    }
+    scope::uring_close_flush();
+    REQUIRE(scope::uring_close_pending() == 0);
+    REQUIRE_FALSE(is_open(fd));
+}
+
+TEST_CASE("uring_close submits a full batch by itself")
+{
+    // A copy: REQUIRE takes a reference, which C++11 can not bind to the
+    // static member without a definition.
+    const unsigned entries = scope::detail::uring_closer::entries;
+    std::vector<int> fds;
+    {
+        std::vector<scope::unique_resource<int, scope::uring_close>> v;
+        for(unsigned i = 0; i < entries + 10; ++i) {
+            fds.push_back(new_fd());
+            v.emplace_back(fds.back(), scope::uring_close{});
+        }
+    }
+    std::size_t closed = 0;
+    for(int fd : fds) {
+        closed += is_open(fd) ? 0 : 1;
+    }
+    REQUIRE(scope::uring_close_pending() <= entries);
+    REQUIRE(closed + scope::uring_close_pending() == fds.size());
+    REQUIRE(closed >= 10);
+    scope::uring_close_flush();
+    for(int fd : fds) {
+        REQUIRE_FALSE(is_open(fd));
+    }
+}
+
+TEST_CASE("uring_close flushes when the thread exits")
+{
+    int fd = new_fd();
+    std::thread t{[fd]{
+        scope::unique_resource<int, scope::uring_close> u{fd, scope::uring_close{}};
+    }};
+    t.join();
+    REQUIRE_FALSE(is_open(fd));
+}
+
+#endif // defined(__unix__)
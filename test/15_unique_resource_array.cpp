@@ -0,0 +1,121 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+struct record
+{
+    std::vector<int>* deleted;
+    void operator()(int r) const { deleted->push_back(r); }
+};
+
+struct record_batch
+{
+    std::vector<std::vector<int>>* batches;
+    void operator()(int* first, std::size_t n) const { batches->emplace_back(first, first + n); }
+};
+
+} // namespace
+
+static_assert(scope::is_batch_deleter<record_batch, int>::value, "");
+static_assert(!scope::is_batch_deleter<record, int>::value, "");
+
+TEST_CASE("unique_resource_array deletes owned resources in order")
+{
+    std::vector<int> deleted;
+    {
+        scope::unique_resource_array<int, record> a{record{&deleted}};
+        for(int i = 0; i < 5; ++i) {
+            REQUIRE(a.push_back(i) == std::size_t(i));
+        }
+        a.release(1);
+        a.reset(3);
+        REQUIRE(deleted == std::vector<int>{3});
+        REQUIRE(a.size() == 5);
+        REQUIRE(a[1] == 1);
+        REQUIRE_FALSE(a.owns(1));
+        REQUIRE_FALSE(a.owns(3));
+        REQUIRE(a.owns(4));
+    }
+    REQUIRE(deleted == (std::vector<int>{3, 0, 2, 4}));
+}
+
+TEST_CASE("unique_resource_array passes the owned resources to a batch deleter at once")
+{
+    std::vector<std::vector<int>> batches;
+    std::vector<int> expected;
+    {
+        scope::unique_resource_array<int, record_batch> a{record_batch{&batches}};
+        for(int i = 0; i < 300; ++i) {
+            a.push_back(i);
+            if(i % 7 == 3 || (i >= 64 && i < 128)) {
+                a.release(i);
+            }
+            else {
+                expected.push_back(i);
+            }
+        }
+    }
+    REQUIRE(batches.size() == 1);
+    REQUIRE(batches[0] == expected);
+}
+
+TEST_CASE("unique_resource_array::reset() removes all elements")
+{
+    std::vector<std::vector<int>> batches;
+    scope::unique_resource_array<int, record_batch> a{record_batch{&batches}};
+    a.push_back(1);
+    a.push_back(2);
+    a.reset();
+    REQUIRE(a.empty());
+    REQUIRE(batches == std::vector<std::vector<int>>{{1, 2}});
+
+    a.push_back(3);
+    a.release();
+    a.reset();
+    REQUIRE(batches.size() == 1); // nothing owned, no call
+}
+
+TEST_CASE("unique_resource_array move")
+{
+    std::vector<int> deleted;
+    {
+        scope::unique_resource_array<std::string, std::function<void(const std::string&)>> a{
+            [&deleted](const std::string& s){ deleted.push_back(static_cast<int>(s.size())); }};
+        a.push_back(std::string(1, 'x'));
+        a.push_back(std::string(2, 'x'));
+        auto b = std::move(a);
+        REQUIRE(a.empty());
+        REQUIRE(b.size() == 2);
+        REQUIRE(b[1] == "xx");
+        a = std::move(b);
+        REQUIRE(deleted.empty());
+    }
+    REQUIRE(deleted == (std::vector<int>{1, 2}));
+}
@@ -0,0 +1,228 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/epoch.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+struct count_deleter
+{
+    int* deleted;
+    void operator()(int) const noexcept { ++*deleted; }
+};
+
+} // namespace
+
+TEST_CASE("retire() runs the deleter after the critical sections end")
+{
+    int deleted = 0;
+    scope::epoch_domain d;
+    {
+        scope::epoch_guard g{d};
+        {
+            scope::epoch_guard nested{d};
+        }
+        scope::retire(scope::unique_resource<int, count_deleter>{1, count_deleter{&deleted}}, d);
+        const auto e = d.epoch();
+        for(int i = 0; i < 5; ++i) {
+            d.try_advance();
+        }
+        REQUIRE(d.epoch() <= e + 1);
+        REQUIRE(deleted == 0);
+        REQUIRE(d.pending() == 1);
+    }
+    d.synchronize();
+    REQUIRE(deleted == 1);
+    REQUIRE(d.pending() == 0);
+}
+
+TEST_CASE("epoch_domain reclaims in batches")
+{
+    int called = 0;
+    scope::epoch_domain d;
+    for(int i = 0; i < 1000; ++i) {
+        d.retire([&called]{ ++called; });
+    }
+    REQUIRE(called > 0);
+    REQUIRE(d.pending() < 2 * scope::epoch_domain::batch);
+    d.synchronize();
+    REQUIRE(called == 1000);
+}
+
+TEST_CASE("epoch_domain reclaims what an exited thread retired")
+{
+    std::atomic<int> called{0};
+    scope::epoch_domain d;
+    std::thread t{[&]{
+        d.retire([&called]{ ++called; });
+    }};
+    t.join();
+    REQUIRE(called == 0);
+    d.synchronize();
+    REQUIRE(called == 1);
+}
+
+TEST_CASE("epoch_domain::pending() is 0 on a thread which did not use the domain")
+{
+    const scope::epoch_domain d;
+    static_assert(noexcept(d.pending()), "");
+    REQUIRE(d.pending() == 0);
+}
+
+TEST_CASE("epoch_domain calls every retired function when it is destroyed")
+{
+    int called = 0;
+    {
+        scope::epoch_domain d;
+        d.retire([&called]{ ++called; });
+        d.retire([&called]{ ++called; });
+    }
+    REQUIRE(called == 2);
+}
+
+TEST_CASE("epoch_domain protects concurrent readers")
+{
+    struct node
+    {
+        std::atomic<bool> alive;
+        int value;
+    };
+    struct delete_node
+    {
+        void operator()(node* n) const noexcept
+        {
+            n->alive = false;
+            delete n;
+        }
+    };
+
+    scope::epoch_domain d;
+    std::atomic<node*> current{new node{{true}, 0}};
+    std::atomic<bool> done{false};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> readers;
+    for(int t = 0; t < 2; ++t) {
+        readers.emplace_back([&]{
+            while(!done) {
+                scope::epoch_guard g{d};
+                node* n = current.load(std::memory_order_acquire);
+                if(!n->alive.load()) {
+                    ++errors;
+                }
+            }
+        });
+    }
+    for(int i = 1; i <= 2000; ++i) {
+        node* old = current.exchange(new node{{true}, i}, std::memory_order_acq_rel);
+        scope::retire(scope::unique_resource<node*, delete_node>{old, delete_node{}}, d);
+        if(i % 100 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    for(auto& t : readers) {
+        t.join();
+    }
+    d.synchronize();
+    delete_node{}(current.load());
+    REQUIRE(errors == 0);
+}
+
+TEST_CASE("epoch_domain protects readers from concurrent unlinks and retires")
+{
+    struct node
+    {
+        std::atomic<bool> alive;
+    };
+
+    // Retired nodes are only marked dead, so that a reader which sees one
+    // reads valid memory, and freed at the end.
+    std::mutex dead_mutex;
+    std::vector<node*> dead;
+    auto retire_node = [&](scope::epoch_domain& d, node* n) {
+        d.retire([&dead_mutex, &dead, n]{
+            n->alive = false;
+            std::lock_guard<std::mutex> lock{dead_mutex};
+            dead.push_back(n);
+        });
+    };
+
+    constexpr int slots = 4;
+    scope::epoch_domain d;
+    std::atomic<node*> links[slots];
+    for(auto& l : links) {
+        l.store(new node{{true}});
+    }
+    std::atomic<bool> done{false};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 2; ++t) {
+        threads.emplace_back([&]{
+            while(!done) {
+                scope::epoch_guard g{d};
+                node* seen[slots];
+                for(int i = 0; i < slots; ++i) {
+                    seen[i] = links[i].load(std::memory_order_acquire);
+                }
+                std::this_thread::yield();
+                for(node* n : seen) {
+                    if(!n->alive.load()) {
+                        ++errors;
+                    }
+                }
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for(int t = 0; t < 2; ++t) {
+        writers.emplace_back([&, t]{
+            for(int i = 0; i < 2000; ++i) {
+                node* old = links[(i + t) % slots].exchange(new node{{true}}, std::memory_order_acq_rel);
+                retire_node(d, old);
+            }
+            d.synchronize();
+        });
+    }
+    for(auto& t : writers) {
+        t.join();
+    }
+    done = true;
+    for(auto& t : threads) {
+        t.join();
+    }
+    d.synchronize();
+    REQUIRE(errors == 0);
+    for(auto& l : links) {
+        delete l.load();
+    }
+    for(node* n : dead) {
+        delete n;
+    }
+}
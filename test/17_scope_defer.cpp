@@ -0,0 +1,127 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("scope_defer calls the exit function at defer_flush()")
+{
+    std::string out;
+    {
+        auto a = scope::make_scope_defer([&]{ out += 'a'; });
+        auto b = scope::make_scope_defer([&]{ out += 'b'; });
+        auto c = scope::make_scope_defer([&]{ out += 'c'; });
+        c.release();
+    }
+    REQUIRE(out.empty());
+    REQUIRE(scope::defer_pending() == 2);
+    scope::defer_flush();
+    REQUIRE(out == "ba");
+    REQUIRE(scope::defer_pending() == 0);
+}
+
+TEST_CASE("scope_defer flushes in batches when the ring is full")
+{
+    int count = 0;
+    for(std::size_t i = 0; i < scope::detail::defer_queue::capacity + 1; ++i) {
+        auto g = scope::make_scope_defer([&count]{ ++count; });
+    }
+    REQUIRE(count == static_cast<int>(scope::detail::defer_queue::capacity));
+    REQUIRE(scope::defer_pending() == 1);
+    scope::defer_flush();
+    REQUIRE(count == static_cast<int>(scope::detail::defer_queue::capacity + 1));
+}
+
+TEST_CASE("scope_defer flushes at thread exit")
+{
+    int count = 0;
+    std::thread t{[&count]{
+        auto g = scope::make_scope_defer([&count]{ ++count; });
+    }};
+    t.join();
+    REQUIRE(count == 1);
+}
+
+TEST_CASE("scope_defer: exit functions deferred while flushing")
+{
+    std::string out;
+    {
+        auto g = scope::make_scope_defer([&out]{
+            out += 'a';
+            auto inner = scope::make_scope_defer([&out]{ out += 'b'; });
+            scope::defer_flush(); // does nothing while flushing
+        });
+    }
+    scope::defer_flush();
+    REQUIRE(out == "ab");
+}
+
+TEST_CASE("scope_defer runs a self-contained exit function after its scope has ended")
+{
+    std::weak_ptr<int> seen;
+    int out = 0;
+    {
+        auto state = std::make_shared<int>(1);
+        seen = state;
+        auto g = scope::make_scope_defer([state, &out]{ out = *state; });
+        *state = 2;
+    }
+    // The exit function owns state until it runs.
+    REQUIRE(out == 0);
+    REQUIRE(!seen.expired());
+    scope::defer_flush();
+    REQUIRE(out == 2);
+    REQUIRE(seen.expired());
+}
+
+namespace {
+
+struct defer_at_thread_exit
+{
+    std::atomic<int>* count;
+
+    ~defer_at_thread_exit()
+    {
+        std::atomic<int>* c = count;
+        auto g = scope::make_scope_defer([c]{ ++*c; });
+    }
+};
+
+} // namespace
+
+TEST_CASE("scope_defer calls the exit function at once after the queue of the thread is destroyed")
+{
+    std::atomic<int> count{0};
+    std::thread t{[&count]{
+        // Constructed before the queue of the thread, so destroyed after it.
+        thread_local defer_at_thread_exit holder{&count};
+        auto g = scope::make_scope_defer([&count]{ ++count; });
+        (void)holder;
+    }};
+    t.join();
+    REQUIRE(count == 2);
+}
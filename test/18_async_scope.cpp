@@ -0,0 +1,243 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/async_scope.hpp"
+
+#if defined(SCOPE_USE_COROUTINE)
+
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <catch2/catch.hpp>
+#include "task.hpp"
+
+using helper::task;
+using helper::yield;
+
+namespace {
+
+task<int> work(std::string& out, bool fail)
+{
+    out += 'w';
+    co_await yield{};
+#if !defined(SCOPE_NO_EXCEPTIONS)
+    if(fail) {
+        throw std::runtime_error("work");
+    }
+#else
+    (void)fail;
+#endif
+    co_return 42;
+}
+
+task<> flush(std::string& out)
+{
+    co_await yield{};
+    out += 'f';
+}
+
+struct ready_ref
+{
+    int& r;
+
+    bool await_ready() const noexcept { return true; }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    int& await_resume() const noexcept { return r; }
+};
+
+} // namespace
+
+TEST_CASE("async_scope_exit awaits the cleanup on every exit path")
+{
+    std::string out;
+    auto run = [&](bool fail) -> task<int> {
+        co_return co_await scope::async_scope_exit(
+            [&]{ return work(out, fail); },
+            [&]{ return flush(out); });
+    };
+
+    REQUIRE(run(false).run() == 42);
+    REQUIRE(out == "wf");
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+    out.clear();
+    REQUIRE_THROWS_AS(run(true).run(), std::runtime_error);
+    REQUIRE(out == "wf");
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+}
+
+TEST_CASE("async_scope_exit passes on a reference the body is awaited as")
+{
+    std::string out;
+    int x = 0;
+    auto run = [&]() -> task<int> {
+        int& r = co_await scope::async_scope_exit(
+            [&]{ return ready_ref{x}; },
+            [&]{ return flush(out); });
+        r = 7;
+        co_return x;
+    };
+
+    REQUIRE(run().run() == 7);
+    REQUIRE(out == "f");
+}
+
+namespace {
+
+// Keeps its payload in the frame of the guard across the co_await.
+struct big_ready
+{
+    char payload[512];
+
+    bool await_ready() const noexcept { return true; }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    int await_resume() const noexcept { return payload[0] + payload[511]; }
+};
+
+} // namespace
+
+TEST_CASE("async guards with a frame larger than the buffer")
+{
+    std::string out;
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+    SECTION("fail by default") {
+        auto run = [&]() -> task<int> {
+            co_return co_await scope::async_scope_exit(
+                [&]{ return big_ready{{1}}; },
+                [&]{ return flush(out); });
+        };
+        REQUIRE_THROWS_AS(run().run(), std::bad_alloc);
+        REQUIRE(out.empty());
+    }
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+    SECTION("go to the heap if allowed") {
+        auto run = [&]() -> task<int> {
+            co_return co_await scope::async_scope_exit<scope::default_async_frame_size, scope::async_frame_overflow::heap>(
+                [&]{ return big_ready{{1}}; },
+                [&]{ return flush(out); });
+        };
+        REQUIRE(run().run() == 1);
+        REQUIRE(out == "f");
+    }
+
+    SECTION("fit in a larger buffer") {
+        auto run = [&]() -> task<int> {
+            co_return co_await scope::async_scope_exit<2048>(
+                [&]{ return big_ready{{1}}; },
+                [&]{ return flush(out); });
+        };
+        REQUIRE(run().run() == 1);
+        REQUIRE(out == "f");
+    }
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+
+TEST_CASE("async_scope_fail and async_scope_success")
+{
+    std::string out;
+    auto run = [&](bool fail) -> task<std::string> {
+        std::string result;
+        try {
+            co_await scope::async_scope_success(
+                [&]{ return work(out, false); },
+                [&]() -> task<> { co_await yield{}; out += 's'; });
+            co_await scope::async_scope_fail(
+                [&]{ return work(out, fail); },
+                [&]() -> task<> { co_await yield{}; out += 'x'; });
+            co_await scope::async_scope_success(
+                [&]{ return work(out, fail); },
+                [&]() -> task<> { co_await yield{}; out += 's'; });
+        }
+        catch(std::runtime_error&) {
+            result = "caught";
+        }
+        co_return result;
+    };
+
+    REQUIRE(run(false).run().empty());
+    REQUIRE(out == "wswws");
+
+    out.clear();
+    REQUIRE(run(true).run() == "caught");
+    REQUIRE(out == "wswx");
+}
+
+TEST_CASE("async guards report the exception of the cleanup if the body succeeded")
+{
+    auto run = []() -> task<> {
+        co_await scope::async_scope_exit(
+            []() -> task<> { co_return; },
+            []() -> task<> { throw std::logic_error("cleanup"); co_return; });
+    };
+    REQUIRE_THROWS_AS(run().run(), std::logic_error);
+
+    auto run2 = []() -> task<> {
+        co_await scope::async_scope_exit(
+            []() -> task<> { throw std::runtime_error("body"); co_return; },
+            []() -> task<> { throw std::logic_error("cleanup"); co_return; });
+    };
+    REQUIRE_THROWS_AS(run2().run(), std::runtime_error);
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+TEST_CASE("with_async_resource awaits the deleter unless released")
+{
+    std::string out;
+    auto close = [&out](int fd) -> task<> {
+        co_await yield{};
+        out += "close" + std::to_string(fd) + ';';
+    };
+    auto run = [&](bool release, bool fail) -> task<> {
+        co_await scope::with_async_resource(3, close, [&](auto& r) -> task<> {
+            out += "use" + std::to_string(r.get()) + ';';
+            co_await yield{};
+            if(release) {
+                r.release();
+            }
+#if !defined(SCOPE_NO_EXCEPTIONS)
+            if(fail) {
+                throw std::runtime_error("use");
+            }
+#else
+            (void)fail;
+#endif
+        });
+    };
+
+    run(false, false).run();
+    REQUIRE(out == "use3;close3;");
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+    out.clear();
+    REQUIRE_THROWS_AS(run(false, true).run(), std::runtime_error);
+    REQUIRE(out == "use3;close3;");
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+    out.clear();
+    run(true, false).run();
+    REQUIRE(out == "use3;");
+}
+
+#endif // defined(SCOPE_USE_COROUTINE)
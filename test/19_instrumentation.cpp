@@ -0,0 +1,164 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#define SCOPE_ENABLE_INSTRUMENTATION
+#include "scope/scope.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+scope::guard_stats stats_at(unsigned line, scope::guard_kind kind)
+{
+    for(const auto& st : scope::guard_stats_snapshot()) {
+        if(st.file && std::strcmp(st.file, __FILE__) == 0 && st.line == line && st.kind == kind) {
+            return st;
+        }
+    }
+    return scope::guard_stats{__FILE__, line, kind, 0, 0, 0, 0};
+}
+
+void deleter(int) noexcept {}
+
+unsigned exit_in_function()
+{
+    auto g = scope::make_scope_exit([]{}); const unsigned line = __LINE__;
+    return line;
+}
+
+} // namespace
+
+TEST_CASE("instrumentation counts the guards created at each site")
+{
+    unsigned line = 0;
+    for(int i = 0; i < 10; ++i) {
+        auto g = scope::make_scope_exit([]{}); line = __LINE__;
+        if(i % 2 == 0) {
+            g.release();
+        }
+    }
+    const auto st = stats_at(line, scope::guard_kind::scope_exit);
+    REQUIRE(st.created == 10);
+    REQUIRE(st.released == 5);
+    REQUIRE(st.fired == 5);
+    REQUIRE(st.fired_during_unwind == 0);
+    REQUIRE(std::strcmp(scope::guard_kind_name(st.kind), "scope_exit") == 0);
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("instrumentation counts the guards fired during stack unwinding")
+{
+    unsigned line = 0;
+    try {
+        scope::scope_exit<void(*)()> g{[]{}}; line = __LINE__;
+        throw std::runtime_error("unwind");
+    }
+    catch(const std::exception&) {
+    }
+    const auto st = stats_at(line, scope::guard_kind::scope_exit);
+    REQUIRE(st.created == 1);
+    REQUIRE(st.fired == 0);
+    REQUIRE(st.fired_during_unwind == 1);
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+TEST_CASE("instrumentation keeps scope_fail and scope_success apart")
+{
+    unsigned line = 0;
+    {
+        auto f = scope::make_scope_fail([]{}); auto s = scope::make_scope_success([]{}); line = __LINE__;
+    }
+    REQUIRE(stats_at(line, scope::guard_kind::scope_fail).created == 1);
+    REQUIRE(stats_at(line, scope::guard_kind::scope_fail).fired == 0);
+    REQUIRE(stats_at(line, scope::guard_kind::scope_success).created == 1);
+    REQUIRE(stats_at(line, scope::guard_kind::scope_success).fired == 1);
+}
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+
+TEST_CASE("instrumentation counts unique_resource at the site which acquired the resource")
+{
+    unsigned line = 0, reset_line = 0;
+    {
+        auto r = scope::make_unique_resource(1, &deleter); line = __LINE__;
+        auto moved = std::move(r);
+        r.release();
+        moved.reset(2); reset_line = __LINE__;
+        auto released = scope::make_unique_resource(3, &deleter);
+        released.release();
+    }
+    auto st = stats_at(line, scope::guard_kind::unique_resource);
+    REQUIRE(st.created == 1);
+    REQUIRE(st.released == 0);
+    REQUIRE(st.fired == 1);
+    st = stats_at(reset_line, scope::guard_kind::unique_resource);
+    REQUIRE(st.created == 1);
+    REQUIRE(st.fired == 1);
+}
+
+TEST_CASE("instrumentation does not count the guards of the library itself")
+{
+    {
+        auto r = scope::make_unique_resource(1, &deleter);
+    }
+    for(const auto& st : scope::guard_stats_snapshot()) {
+        REQUIRE((!st.file || std::strstr(st.file, "scope.hpp") == nullptr));
+    }
+}
+
+TEST_CASE("instrumentation sums the counters of every thread, including exited ones")
+{
+    const unsigned line = exit_in_function();
+    const auto before = stats_at(line, scope::guard_kind::scope_exit);
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; ++i) {
+        threads.emplace_back([]{
+            for(int j = 0; j < 100; ++j) {
+                exit_in_function();
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    const auto after = stats_at(line, scope::guard_kind::scope_exit);
+    REQUIRE(after.created - before.created == 400);
+    REQUIRE(after.fired - before.fired == 400);
+}
+
+TEST_CASE("instrumentation counts a guard destroyed on another thread")
+{
+    unsigned line = 0;
+    {
+        auto g = scope::make_scope_exit([]{}); line = __LINE__;
+        std::thread t{[&g]{ auto moved = std::move(g); }};
+        t.join();
+    }
+    const auto st = stats_at(line, scope::guard_kind::scope_exit);
+    REQUIRE(st.created == 1);
+    REQUIRE(st.fired == 1);
+    REQUIRE(st.released == 0);
+}
@@ -0,0 +1,209 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/histogram.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+struct fake_ticks
+{
+    static std::uint64_t value;
+    static std::uint64_t now() noexcept { return value; }
+};
+
+std::uint64_t fake_ticks::value = 0;
+
+struct noop_deleter
+{
+    void operator()(int) const noexcept {}
+};
+
+struct pool_tag {};
+
+using timed_resource = scope::unique_resource<int, noop_deleter, scope::hold_time<void, fake_ticks>>;
+
+scope::histogram_snapshot resource_hold_times()
+{
+    return scope::hold_time_histogram<scope::resource_key<int, noop_deleter>, fake_ticks>().snapshot();
+}
+
+} // namespace
+
+// The policy is an empty base: the layout is unchanged unless it has state.
+static_assert(sizeof(scope::unique_resource<int*, void (*)(int*), scope::null_resource_policy>) == 3 * sizeof(void*), "");
+static_assert(sizeof(scope::unique_resource<int, noop_deleter, scope::hold_time<>>) == 2 * sizeof(std::uint64_t), "");
+
+TEST_CASE("histogram buckets are log-linear")
+{
+    using snapshot = scope::histogram_snapshot;
+    for(std::size_t i = 0; i < snapshot::buckets; ++i) {
+        const std::uint64_t lo = snapshot::bucket_lower(i);
+        const std::uint64_t hi = snapshot::bucket_upper(i);
+        REQUIRE(lo <= hi);
+        REQUIRE(snapshot::bucket_of(lo) == i);
+        REQUIRE(snapshot::bucket_of(hi) == i);
+        REQUIRE((hi - lo) <= lo / 16);
+        if(i + 1 < snapshot::buckets) {
+            REQUIRE(snapshot::bucket_lower(i + 1) == hi + 1);
+        }
+    }
+    REQUIRE(snapshot::bucket_upper(snapshot::buckets - 1) == UINT64_MAX);
+}
+
+TEST_CASE("histogram percentiles are within the width of a bucket")
+{
+    scope::histogram h;
+    for(std::uint64_t v = 1; v <= 1000; ++v) {
+        h.record(v);
+    }
+    const auto s = h.snapshot();
+    REQUIRE(s.count() == 1000);
+    REQUIRE(s.sum() == 500500);
+    REQUIRE(s.max() == 1000);
+    REQUIRE(s.mean() == Approx(500.5));
+    REQUIRE(s.percentile(50) >= 500);
+    REQUIRE(s.percentile(50) <= 500 + 500 / 16);
+    REQUIRE(s.percentile(99) >= 990);
+    REQUIRE(s.percentile(100) == 1000);
+    REQUIRE(scope::histogram{}.snapshot().percentile(50) == 0);
+}
+
+TEST_CASE("histogram sums the shards of every thread, including exited ones")
+{
+    scope::histogram h;
+    h.record(1);
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; ++i) {
+        threads.emplace_back([&h]{
+            for(int j = 0; j < 1000; ++j) {
+                h.record(static_cast<std::uint64_t>(j));
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    auto s = h.snapshot();
+    REQUIRE(s.count() == 4001);
+    REQUIRE(s.max() == 999);
+
+    std::thread t{[&h]{ h.record(5000); }};
+    t.join();
+    s = h.snapshot();
+    REQUIRE(s.count() == 4002);
+    REQUIRE(s.max() == 5000);
+
+    scope::histogram_snapshot total;
+    total += s;
+    total += s;
+    REQUIRE(total.count() == 8004);
+    REQUIRE(total.bucket_count(scope::histogram_snapshot::bucket_of(5000)) == 2);
+}
+
+TEST_CASE("histogram may be destroyed before the threads which recorded into it exit")
+{
+    // A second histogram takes the address of the first: the shards left by
+    // the first must be neither recorded into nor freed twice.
+    alignas(scope::histogram) unsigned char storage[sizeof(scope::histogram)];
+    scope::histogram* h = ::new(static_cast<void*>(storage)) scope::histogram;
+    std::atomic<int> step{0};
+    const auto wait_for = [&step](int n) {
+        while(step.load() < n) {
+            std::this_thread::yield();
+        }
+    };
+
+    std::thread exits{[&]{
+        h->record(1);
+        ++step;
+        wait_for(3);
+    }};
+    std::thread records_again{[&]{
+        h->record(1);
+        ++step;
+        wait_for(3);
+        h->record(2);
+        ++step;
+        wait_for(5);
+    }};
+    wait_for(2);
+    REQUIRE(h->snapshot().count() == 2);
+    h->~histogram();
+    h = ::new(static_cast<void*>(storage)) scope::histogram;
+    ++step;
+    exits.join();
+    wait_for(4);
+    auto s = h->snapshot();
+    REQUIRE(s.count() == 1);
+    REQUIRE(s.max() == 2);
+    ++step;
+    records_again.join();
+    h->record(3);
+    s = h->snapshot();
+    REQUIRE(s.count() == 2);
+    REQUIRE(s.max() == 3);
+    h->~histogram();
+}
+
+TEST_CASE("hold_time records how long a unique_resource owned its resource")
+{
+    const auto before = resource_hold_times();
+    fake_ticks::value = 100;
+    {
+        timed_resource r{1, noop_deleter{}};
+        fake_ticks::value = 130;
+        r.reset(2);          // held 30
+        fake_ticks::value = 200;
+        timed_resource moved{std::move(r)};
+        fake_ticks::value = 250;
+    }                        // held 120
+    {
+        timed_resource r{3, noop_deleter{}};
+        r.release();         // not recorded
+        timed_resource none;
+    }
+    const auto after = resource_hold_times();
+    REQUIRE(after.count() - before.count() == 2);
+    REQUIRE(after.sum() - before.sum() == 150);
+    REQUIRE(after.max() >= 120);
+}
+
+TEST_CASE("hold_time keyed by a tag")
+{
+    using pool_slot = scope::unique_resource<int, noop_deleter, scope::hold_time<pool_tag, fake_ticks>>;
+    auto& h = scope::hold_time_histogram<pool_tag, fake_ticks>();
+    const auto before = h.snapshot().count();
+    fake_ticks::value = 0;
+    {
+        pool_slot a{1, noop_deleter{}};
+        pool_slot b{2, noop_deleter{}};
+        fake_ticks::value = 10;
+    }
+    REQUIRE(h.snapshot().count() - before == 2);
+}
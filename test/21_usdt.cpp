@@ -0,0 +1,172 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#define SCOPE_ENABLE_USDT
+#include "scope/scope.hpp"
+
+#if defined(SCOPE_HAS_USDT)
+
+#include <elf.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include "helper.hpp"
+
+using namespace helper;
+
+namespace {
+
+struct usdt_probe
+{
+    std::uint64_t pc;
+    std::string provider;
+    std::string name;
+    std::string args;
+};
+
+// The probes in the .note.stapsdt section of the test executable.
+std::vector<usdt_probe> read_probes()
+{
+    std::ifstream in{"/proc/self/exe", std::ios::binary};
+    const std::string elf{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    std::vector<usdt_probe> probes;
+    if(elf.size() < sizeof(Elf64_Ehdr) || elf.compare(0, SELFMAG, ELFMAG) != 0) {
+        return probes;
+    }
+    Elf64_Ehdr eh;
+    std::memcpy(&eh, elf.data(), sizeof(eh));
+    std::vector<Elf64_Shdr> sh(eh.e_shnum);
+    std::memcpy(sh.data(), elf.data() + eh.e_shoff, eh.e_shnum * sizeof(Elf64_Shdr));
+    const char* names = elf.data() + sh[eh.e_shstrndx].sh_offset;
+    for(const auto& s : sh) {
+        if(s.sh_type != SHT_NOTE || std::strcmp(names + s.sh_name, ".note.stapsdt") != 0) {
+            continue;
+        }
+        for(std::size_t off = 0; off + sizeof(Elf64_Nhdr) <= s.sh_size;) {
+            Elf64_Nhdr nh;
+            std::memcpy(&nh, elf.data() + s.sh_offset + off, sizeof(nh));
+            const char* name = elf.data() + s.sh_offset + off + sizeof(nh);
+            const char* desc = name + ((nh.n_namesz + 3) & ~3u);
+            if(nh.n_type == 3 && std::strcmp(name, "stapsdt") == 0) {
+                usdt_probe p;
+                std::memcpy(&p.pc, desc, sizeof(p.pc));
+                p.provider = desc + 24;
+                p.name = desc + 24 + p.provider.size() + 1;
+                p.args = desc + 24 + p.provider.size() + 1 + p.name.size() + 1;
+                probes.push_back(p);
+            }
+            off += sizeof(nh) + ((nh.n_namesz + 3) & ~3u) + ((nh.n_descsz + 3) & ~3u);
+        }
+    }
+    return probes;
+}
+
+std::size_t count_probes(const std::vector<usdt_probe>& probes, const char* name)
+{
+    std::size_t n = 0;
+    for(const auto& p : probes) {
+        if(p.provider == "scope" && p.name == name) {
+            REQUIRE(p.pc != 0);
+            REQUIRE(p.args.compare(0, 3, "-4@") == 0);
+            REQUIRE(p.args.find(" 8@") != std::string::npos);
+            REQUIRE(p.args.find(" 1@") != std::string::npos);
+            ++n;
+        }
+    }
+    return n;
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+struct ThrowOnCopy
+{
+    ThrowOnCopy() noexcept {}
+    ThrowOnCopy(const ThrowOnCopy&) { throw TestException(); }
+    void operator()() const noexcept { value_of_func++; }
+};
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+struct usdt_deleter
+{
+    void operator()(int) const noexcept { value_of_func++; }
+};
+
+void count_exit() { value_of_func++; }
+
+} // namespace
+
+TEST_CASE("USDT probes do not change what the guards do")
+{
+    value_of_func = 0;
+    {
+        auto g = scope::make_scope_exit([]{ value_of_func++; });
+        auto released = scope::make_scope_exit([]{ value_of_func += 10; });
+        released.release();
+    }
+    REQUIRE(value_of_func == 1);
+
+    {
+        scope::unique_resource<int, usdt_deleter> r{1, usdt_deleter{}};
+        scope::unique_resource<int, usdt_deleter> released{2, usdt_deleter{}};
+        released.release();
+        r.reset(3);
+    }
+    REQUIRE(value_of_func == 3);
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+    try {
+        ThrowOnCopy f;
+        scope::scope_exit<ThrowOnCopy> g{f};
+    }
+    catch(const TestException&) {
+    }
+    REQUIRE(value_of_func == 4);
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+}
+
+TEST_CASE("USDT probes pass the address of the function a function pointer points to")
+{
+    void (*f)() = &count_exit;
+    void_func_t g = &func;
+    const usdt_deleter d{};
+    REQUIRE(scope::detail::probe_address(f) == reinterpret_cast<const void*>(&count_exit));
+    REQUIRE(scope::detail::probe_address(g) == reinterpret_cast<const void*>(&func));
+    REQUIRE(scope::detail::probe_address(count_exit) == reinterpret_cast<const void*>(&count_exit));
+    REQUIRE(scope::detail::probe_address(d) == static_cast<const void*>(&d));
+}
+
+TEST_CASE("USDT probes are recorded in .note.stapsdt")
+{
+    const auto probes = read_probes();
+    REQUIRE(count_probes(probes, "guard_exit") > 0);
+#if !defined(SCOPE_NO_EXCEPTIONS)
+    REQUIRE(count_probes(probes, "guard_construct_failed") > 0);
+#endif
+    REQUIRE(count_probes(probes, "resource_reset") > 0);
+    REQUIRE(count_probes(probes, "resource_release") > 0);
+}
+
+#endif // defined(SCOPE_HAS_USDT)
@@ -0,0 +1,157 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/timer.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+struct fake_ticks
+{
+    static std::uint64_t value;
+    static std::uint64_t now() noexcept { return value; }
+    static const char* unit() noexcept { return "ticks"; }
+};
+
+std::uint64_t fake_ticks::value = 0;
+
+SCOPE_TIMER_REGION(parse_region, "parse");
+SCOPE_TIMER_REGION(quoted_region, "say \"hi\"");
+SCOPE_TIMER_REGION(exit_region, "at exit");
+
+// Constant initialized, so destroyed after every region: enters a region,
+// which is dropped since the thread has exited, and walks them all once they
+// would have been destroyed.
+struct check_timers_at_exit
+{
+    std::uint64_t expected;
+
+    ~check_timers_at_exit()
+    {
+        if(expected == 0) {
+            return;
+        }
+        {
+            auto t = scope::make_scope_timer<exit_region, fake_ticks>();
+        }
+        std::uint64_t count = 0;
+        scope::for_each_timer([&count](const char* name, const char*, const scope::histogram_snapshot& s) {
+            if(std::strcmp(name, "at exit") == 0) {
+                count = s.count();
+            }
+        });
+        if(count != expected) {
+            std::fprintf(stderr, "scope_timer: %llu records of \"at exit\" after static destruction, expected %llu\n",
+                         static_cast<unsigned long long>(count), static_cast<unsigned long long>(expected));
+            std::abort();
+        }
+    }
+};
+
+check_timers_at_exit timers_at_exit{0};
+
+} // namespace
+
+TEST_CASE("scope_timer records the time spent in its scope")
+{
+    auto& h = scope::timer_histogram<parse_region, fake_ticks>();
+    const auto before = h.snapshot();
+    fake_ticks::value = 1000;
+    {
+        auto t = scope::make_scope_timer<parse_region, fake_ticks>();
+        fake_ticks::value = 1040;
+    }
+    {
+        auto t = scope::make_scope_timer<parse_region, fake_ticks>();
+        fake_ticks::value = 1100;
+        t.release();
+    }
+    const auto after = h.snapshot();
+    REQUIRE(after.count() - before.count() == 1);
+    REQUIRE(after.sum() - before.sum() == 40);
+}
+
+TEST_CASE("scope_timer sums the threads which entered the region")
+{
+    auto& h = scope::timer_histogram<parse_region>();
+    const auto before = h.snapshot().count();
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; ++i) {
+        threads.emplace_back([]{
+            for(int j = 0; j < 100; ++j) {
+                auto t = scope::make_scope_timer<parse_region>();
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    REQUIRE(h.snapshot().count() - before == 400);
+}
+
+TEST_CASE("scope_timer reports every region as text and JSON")
+{
+    {
+        auto t = scope::make_scope_timer<quoted_region, fake_ticks>();
+    }
+    int regions = 0;
+    bool found = false;
+    scope::for_each_timer([&](const char* name, const char* unit, const scope::histogram_snapshot& s) {
+        ++regions;
+        if(std::string(name) == "say \"hi\"") {
+            found = true;
+            REQUIRE(std::string(unit) == "ticks");
+            REQUIRE(s.count() >= 1);
+        }
+    });
+    REQUIRE(found);
+    REQUIRE(regions >= 3); // parse in fake_ticks and steady_ticks
+
+    const std::string text = scope::timer_report_text();
+    REQUIRE(text.compare(0, 6, "region") == 0);
+    REQUIRE(text.find("parse") != std::string::npos);
+
+    const std::string json = scope::timer_report_json();
+    REQUIRE(json.compare(0, 12, "{\"timers\": [") == 0);
+    REQUIRE(json.find("{\"region\": \"parse\", \"unit\": \"ns\", \"count\": ") != std::string::npos);
+    REQUIRE(json.find("\"region\": \"say \\\"hi\\\"\", \"unit\": \"ticks\"") != std::string::npos);
+    REQUIRE(json.compare(json.size() - 2, 2, "]}") == 0);
+}
+
+TEST_CASE("scope_timer regions outlive static destruction")
+{
+    auto& h = scope::timer_histogram<exit_region, fake_ticks>();
+    std::thread t{[]{
+        auto timer = scope::make_scope_timer<exit_region, fake_ticks>();
+    }};
+    t.join();
+    timers_at_exit.expected = h.snapshot().count();
+    REQUIRE(timers_at_exit.expected == 1);
+}
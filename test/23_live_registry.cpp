@@ -0,0 +1,220 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#define SCOPE_ENABLE_LIVE_REGISTRY
+#include "scope/scope.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+struct close_fd
+{
+    void operator()(int) const noexcept {}
+};
+
+// The live resources acquired in this file.
+std::vector<scope::live_resource> live_here()
+{
+    std::vector<scope::live_resource> out;
+    for(const auto& r : scope::live_resources_snapshot()) {
+        if(r.file && std::strcmp(r.file, __FILE__) == 0) {
+            out.push_back(r);
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+TEST_CASE("live registry: unique_resource joins on acquisition and leaves on reset")
+{
+    REQUIRE(live_here().empty());
+    unsigned line = 0;
+    {
+        scope::unique_resource<int, close_fd> fd{42, close_fd{}}; line = __LINE__;
+        auto live = live_here();
+        REQUIRE(live.size() == 1);
+        REQUIRE(live[0].line == line);
+        REQUIRE(live[0].has_value);
+        REQUIRE(live[0].value == 42);
+
+        fd.reset();
+        REQUIRE(live_here().empty());
+
+        fd.reset(7); line = __LINE__;
+        live = live_here();
+        REQUIRE(live.size() == 1);
+        REQUIRE(live[0].line == line);
+        REQUIRE(live[0].value == 7);
+    }
+    REQUIRE(live_here().empty());
+}
+
+TEST_CASE("live registry: release() leaves")
+{
+    auto fd = scope::make_unique_resource(3, close_fd{}); const unsigned line = __LINE__;
+    REQUIRE(live_here().size() == 1);
+    REQUIRE(live_here()[0].line == line);
+    fd.release();
+    REQUIRE(live_here().empty());
+}
+
+TEST_CASE("live registry: a resource which is not owned does not join")
+{
+    auto fd = scope::make_unique_resource_checked(-1, -1, close_fd{});
+    REQUIRE(live_here().empty());
+    scope::unique_resource<int, close_fd> empty;
+    REQUIRE(live_here().empty());
+}
+
+TEST_CASE("live registry: the entry moves with the resource")
+{
+    scope::unique_resource<int, close_fd> a{1, close_fd{}}; const unsigned line = __LINE__;
+    scope::unique_resource<int, close_fd> b{std::move(a)};
+    auto live = live_here();
+    REQUIRE(live.size() == 1);
+    REQUIRE(live[0].line == line);
+
+    scope::unique_resource<int, close_fd> c{2, close_fd{}};
+    REQUIRE(live_here().size() == 2);
+    c = std::move(b);
+    live = live_here();
+    REQUIRE(live.size() == 1);
+    REQUIRE(live[0].value == 1);
+
+    c.reset();
+    REQUIRE(live_here().empty());
+}
+
+TEST_CASE("live registry: a resource which is not an integer or a pointer has no value")
+{
+    struct release_string
+    {
+        void operator()(const std::string&) const noexcept {}
+    };
+    scope::unique_resource<std::string, release_string> s{std::string("name"), release_string{}};
+    int x = 0;
+    scope::unique_resource<int*, void(*)(int*)> p{&x, [](int*) noexcept {}};
+    auto live = live_here();
+    REQUIRE(live.size() == 2);
+    for(const auto& r : live) {
+        if(r.has_value) {
+            REQUIRE(r.value == reinterpret_cast<std::uintptr_t>(&x));
+        }
+    }
+    REQUIRE(live[0].has_value != live[1].has_value);
+}
+
+TEST_CASE("live registry: the snapshot lists old resources first, and filters by age")
+{
+    scope::unique_resource<int, close_fd> old{1, close_fd{}};
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    scope::unique_resource<int, close_fd> young{2, close_fd{}};
+
+    auto live = live_here();
+    REQUIRE(live.size() == 2);
+    REQUIRE(live[0].value == 1);
+    REQUIRE(live[0].age_ns >= live[1].age_ns);
+
+    std::vector<scope::live_resource> out;
+    scope::live_resources_snapshot(out, 30 * 1000 * 1000);
+    REQUIRE(out.size() == 1);
+    REQUIRE(out[0].value == 1);
+    REQUIRE(out[0].age_ns >= 30 * 1000 * 1000);
+}
+
+TEST_CASE("live registry: resources of many threads")
+{
+    constexpr int threads = 4;
+    constexpr int per_thread = 1000;
+    std::vector<std::vector<scope::unique_resource<int, close_fd>>> held(threads);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; ++t) {
+        workers.emplace_back([&held, t]{
+            held[t].reserve(per_thread);
+            for(int i = 0; i < per_thread; ++i) {
+                // Constructed here: emplace_back would record the site in <vector>.
+                held[t].push_back(scope::unique_resource<int, close_fd>{t * per_thread + i, close_fd{}});
+            }
+        });
+    }
+    for(auto& w : workers) {
+        w.join();
+    }
+    auto live = live_here();
+    REQUIRE(live.size() == threads * per_thread);
+    std::vector<bool> seen(threads * per_thread);
+    for(const auto& r : live) {
+        seen[r.value] = true;
+    }
+    REQUIRE(std::find(seen.begin(), seen.end(), false) == seen.end());
+    REQUIRE(scope::live_resources_untracked() == 0);
+
+    held.clear();
+    REQUIRE(live_here().empty());
+}
+
+TEST_CASE("live registry: a thread which fills its shard moves to another")
+{
+    const int n = 3 * SCOPE_LIVE_REGISTRY_SHARD_SLOTS;
+    std::vector<scope::unique_resource<int, close_fd>> held;
+    held.reserve(n);
+    for(int i = 0; i < n; ++i) {
+        held.push_back(scope::unique_resource<int, close_fd>{i, close_fd{}});
+    }
+    REQUIRE(live_here().size() == static_cast<std::size_t>(n));
+    REQUIRE(scope::live_resources_untracked() == 0);
+
+    held.clear();
+    REQUIRE(live_here().empty());
+
+    // The shards given up, now empty, are claimed again.
+    const auto shards = []{
+        std::size_t count = 0;
+        for(auto r = scope::live_detail::live_shard::head().load(); r; r = r->next()) {
+            ++count;
+        }
+        return count;
+    };
+    const std::size_t before = shards();
+    for(int i = 0; i < n; ++i) {
+        held.push_back(scope::unique_resource<int, close_fd>{i, close_fd{}});
+    }
+    REQUIRE(live_here().size() == static_cast<std::size_t>(n));
+    held.clear();
+    REQUIRE(shards() == before);
+}
+
+TEST_CASE("live registry: report")
+{
+    scope::unique_resource<int, close_fd> fd{42, close_fd{}}; const unsigned line = __LINE__;
+    const std::string report = scope::live_resources_report_text();
+    REQUIRE(report.find(std::string(__FILE__) + ":" + std::to_string(line)) != std::string::npos);
+    REQUIRE(report.find(" 42 ") != std::string::npos);
+}
@@ -0,0 +1,188 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#define SCOPE_ENABLE_EXTERN_TEMPLATES
+#include "scope/scope.hpp"
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#include <catch2/catch.hpp>
+#include "helper.hpp"
+
+using namespace helper;
+
+namespace {
+
+int closed = 0;
+
+int close_fd(int) { ++closed; return 0; }
+
+int close_file(std::FILE* f) { return std::fclose(f); }
+
+void release_memory(void* p) { ::operator delete(p); }
+
+void count_exit() { ++value_of_func; }
+
+} // namespace
+
+TEST_CASE("extern templates: scope_exit of a function pointer and of std::function")
+{
+    value_of_func = 0;
+    {
+        scope::scope_exit<void(*)()> g{&count_exit};
+        scope::scope_exit<void(*)()> g2{std::move(g)};
+    }
+    REQUIRE(value_of_func == 1);
+
+    std::string out;
+    {
+        scope::scope_exit<std::function<void()>> g{[&]{ out += 'a'; }};
+        scope::scope_exit<std::function<void()>> g2{[&]{ out += 'b'; }};
+        g2.release();
+    }
+    REQUIRE(out == "a");
+}
+
+#if defined(SCOPE_USE_SUCCESS_FAIL)
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("extern templates: scope_success and scope_fail of std::function")
+{
+    std::string out;
+    try {
+        scope::scope_success<std::function<void()>> s{[&]{ out += 's'; }};
+        scope::scope_fail<std::function<void()>> f{[&]{ out += 'f'; }};
+        throw 42;
+    }
+    catch(int) {
+    }
+    REQUIRE(out == "f");
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+#endif // defined(SCOPE_USE_SUCCESS_FAIL)
+
+TEST_CASE("extern templates: unique_resource of a file descriptor, FILE* and void*")
+{
+    closed = 0;
+    {
+        scope::unique_resource<int, int(*)(int)> fd{3, &close_fd};
+        scope::unique_resource<int, int(*)(int)> fd2{4, &close_fd};
+        fd2 = std::move(fd);
+        REQUIRE(closed == 1);
+        REQUIRE(fd2.get() == 3);
+        fd2.reset(5);
+        REQUIRE(closed == 2);
+    }
+    REQUIRE(closed == 3);
+
+    {
+        scope::unique_resource<std::FILE*, int(*)(std::FILE*)> f{std::tmpfile(), &close_file};
+        REQUIRE(f.get() != nullptr);
+    }
+
+    {
+        scope::unique_resource<void*, void(*)(void*)> p{::operator new(16), &release_memory};
+        REQUIRE(p.get() != nullptr);
+    }
+}
+
+TEST_CASE("unique_resource::operator=(unique_resource&&) copies what can not be moved without throwing")
+{
+    struct R
+    {
+        int value;
+        explicit R(int v) noexcept : value{v} {}
+        R(const R&) = default;
+        R(R&& r) noexcept : value{r.value} {}
+        R& operator=(const R&) = default;
+        R& operator=(R&& r) { value = r.value; r.value = -1; return *this; }
+    };
+    struct D
+    {
+        std::string* out;
+        void operator()(const R& r) const { *out += std::to_string(r.value); }
+    };
+    REQUIRE(!std::is_nothrow_move_assignable<scope::unique_resource<R, D>>::value);
+    REQUIRE(std::is_nothrow_move_assignable<scope::unique_resource<int, int(*)(int)>>::value);
+
+    std::string out;
+    {
+        scope::unique_resource<R, D> a{R{1}, D{&out}};
+        scope::unique_resource<R, D> b{R{2}, D{&out}};
+        b = std::move(a);
+        REQUIRE(out == "2");
+        REQUIRE(b.get().value == 1);
+        REQUIRE(a.get().value == 1);
+    }
+    REQUIRE(out == "21");
+}
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("unique_resource::operator=(unique_resource&&) assigns a throwing deleter before taking the resource")
+{
+    struct R
+    {
+        int value;
+        explicit R(int v) noexcept : value{v} {}
+        R(const R&) = default;
+        R(R&& r) noexcept : value{r.value} { r.value = -1; }
+        R& operator=(const R&) = default;
+        R& operator=(R&& r) noexcept { value = r.value; r.value = -1; return *this; }
+    };
+    struct D
+    {
+        std::string* out;
+        bool throws;
+        D(std::string* o, bool t) noexcept : out{o}, throws{t} {}
+        D(const D&) = default;
+        D& operator=(const D& d)
+        {
+            if(d.throws) {
+                throw TestException();
+            }
+            out = d.out;
+            return *this;
+        }
+        void operator()(const R& r) const { *out += std::to_string(r.value); }
+    };
+    REQUIRE(std::is_nothrow_move_assignable<R>::value);
+    REQUIRE(!std::is_nothrow_move_assignable<D>::value);
+
+    std::string out;
+    {
+        scope::unique_resource<R, D> a{R{1}, D{&out, true}};
+        scope::unique_resource<R, D> b{R{2}, D{&out, false}};
+        try {
+            b = std::move(a);
+            REQUIRE(false); // not reached
+        }
+        catch(TestException&) {
+        }
+        REQUIRE(out == "2");
+        REQUIRE(a.get().value == 1);
+    }
+    REQUIRE(out == "21");
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
@@ -0,0 +1,204 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+#if defined(__cpp_lib_jthread)
+#include <stop_token>
+#endif
+
+#include <catch2/catch.hpp>
+#include "helper.hpp"
+
+using namespace helper;
+
+namespace {
+
+struct cancel_token
+{
+    bool requested = false;
+    bool stop_requested() const noexcept { return requested; }
+};
+
+struct ExitFunc
+{
+    void operator()() const noexcept { value_of_func++; }
+};
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+struct ThrowOnCopy
+{
+    ThrowOnCopy() noexcept {}
+    ThrowOnCopy(const ThrowOnCopy&) { throw TestException(); }
+    void operator()() const noexcept { value_of_func++; }
+};
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
+
+// A user-defined strategy: calls when the bound counter is odd.
+struct strategy_odd
+{
+    const int* n;
+    bool call_when_dtor() const noexcept { return *n % 2 != 0; }
+    bool call_when_construct_failed() const noexcept { return false; }
+};
+
+} // namespace
+
+TEST_CASE("make_scope_error calls the exit function only if the bound error is set")
+{
+    std::string out;
+    {
+        std::error_code ec;
+        auto g = scope::make_scope_error([&]{ out += 'a'; }, ec);
+    }
+    REQUIRE(out.empty());
+    {
+        std::error_code ec;
+        auto g = scope::make_scope_error([&]{ out += 'b'; }, ec);
+        ec = std::make_error_code(std::errc::invalid_argument);
+    }
+    REQUIRE(out == "b");
+    {
+        int err = 0;
+        auto g = scope::make_scope_error([&]{ out += 'c'; }, err);
+        err = 22;
+        g.release();
+    }
+    REQUIRE(out == "b");
+}
+
+TEST_CASE("make_scope_flag calls the exit function only if the bound flag is true")
+{
+    std::string out;
+    for(bool fail : {false, true}) {
+        bool failed = true;
+        auto g = scope::make_scope_flag([&]{ out += fail ? 'f' : 's'; }, failed);
+        failed = fail;
+    }
+    REQUIRE(out == "f");
+}
+
+TEST_CASE("make_scope_cancel calls the exit function only if cancellation was requested")
+{
+    std::string out;
+    cancel_token token;
+    {
+        auto g = scope::make_scope_cancel([&]{ out += 'a'; }, token);
+    }
+    REQUIRE(out.empty());
+    {
+        auto g = scope::make_scope_cancel([&]{ out += 'b'; }, token);
+        token.requested = true;
+    }
+    REQUIRE(out == "b");
+
+#if defined(__cpp_lib_jthread)
+    std::stop_source source;
+    {
+        std::stop_token st = source.get_token();
+        auto g = scope::make_scope_cancel([&]{ out += 'c'; }, st);
+        source.request_stop();
+    }
+    REQUIRE(out == "bc");
+#endif // defined(__cpp_lib_jthread)
+}
+
+TEST_CASE("strategy guards need no separate armed flag")
+{
+    auto f = []{};
+    using flag_guard = scope::scope_guard<decltype(f), scope::strategy_flag>;
+    using error_guard = scope::scope_guard<decltype(f), scope::strategy_error<std::error_code>>;
+    REQUIRE(sizeof(flag_guard) == sizeof(const bool*));
+    REQUIRE(sizeof(error_guard) == sizeof(const std::error_code*));
+    REQUIRE(std::is_nothrow_destructible<flag_guard>::value);
+}
+
+TEST_CASE("scope_guard moves the strategy with the exit function")
+{
+    std::string out;
+    bool failed = false;
+    {
+        auto g = scope::make_scope_flag([&]{ out += 'a'; }, failed);
+        auto h = std::move(g);
+        failed = true;
+    }
+    REQUIRE(out == "a");
+}
+
+TEST_CASE("scope_guard accepts a user-defined strategy")
+{
+    int n = 0;
+    value_of_func = 0;
+    {
+        scope::scope_guard<ExitFunc, strategy_odd> g(ExitFunc{}, strategy_odd{&n});
+        n = 1;
+    }
+    REQUIRE(value_of_func == 1);
+
+    value_of_func = 0;
+    {
+        auto g = scope::make_scope_guard(ExitFunc{}, strategy_odd{&n});
+        n = 2;
+    }
+    REQUIRE(value_of_func == 0);
+
+    {
+        auto g = scope::make_scope_guard(ExitFunc{}, strategy_odd{&n});
+        n = 3;
+        g.release();
+    }
+    REQUIRE(value_of_func == 0);
+}
+
+#if defined(SCOPE_USE_DEDUCTION_GUIDE)
+TEST_CASE("scope_guard deduces its strategy")
+{
+    bool flag = false;
+    auto f = []{};
+    scope::scope_guard g(f, scope::strategy_flag{flag});
+    REQUIRE((std::is_same<decltype(g), scope::scope_guard<decltype(f), scope::strategy_flag>>::value));
+}
+#endif // defined(SCOPE_USE_DEDUCTION_GUIDE)
+
+#if !defined(SCOPE_NO_EXCEPTIONS)
+TEST_CASE("strategy guards call the exit function if it can not be stored")
+{
+    bool failed = false;
+    value_of_func = 0;
+    try {
+        ThrowOnCopy f;
+        scope::scope_guard<ThrowOnCopy, scope::strategy_flag> g(f, scope::strategy_flag{failed}); // throw exception
+        REQUIRE(false); // not reached
+    }
+    catch(TestException&) {
+        REQUIRE(value_of_func == 1);
+    }
+}
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
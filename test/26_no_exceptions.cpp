@@ -0,0 +1,121 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "scope/scope.hpp"
+
+#if defined(SCOPE_NO_EXCEPTIONS)
+
+#include <string>
+#include <type_traits>
+
+#include <catch2/catch.hpp>
+#include "helper.hpp"
+
+using namespace helper;
+
+namespace {
+
+struct may_throw
+{
+    void operator()() { value_of_func++; }
+};
+
+} // namespace
+
+TEST_CASE("without exceptions scope_success calls its exit function as scope_exit does")
+{
+    std::string out;
+    {
+        auto e = scope::make_scope_exit([&]{ out += 'e'; });
+        auto s = scope::make_scope_success([&]{ out += 's'; });
+        auto r = scope::make_scope_success([&]{ out += 'r'; });
+        r.release();
+    }
+    REQUIRE(out == "se");
+
+    REQUIRE(std::is_empty<scope::strategy_success>::value);
+    REQUIRE(std::is_nothrow_destructible<scope::scope_success<may_throw>>::value);
+    REQUIRE(sizeof(scope::scope_success<void_func_t>) == sizeof(scope::scope_exit<void_func_t>));
+}
+
+TEST_CASE("without exceptions scope_fail never calls its exit function")
+{
+    value_of_func = 0;
+    {
+        auto f = scope::make_scope_fail(func);
+        auto moved = scope::make_scope_fail(func);
+        auto g = std::move(moved);
+        g.release();
+    }
+    REQUIRE(value_of_func == 0);
+    REQUIRE(std::is_empty<scope::strategy_fail>::value);
+}
+
+TEST_CASE("without exceptions the guards live in an inline namespace of their own")
+{
+    REQUIRE((std::is_same<scope::scope_fail<void_func_t>, scope::noexcept_::scope_fail<void_func_t>>::value));
+    REQUIRE((std::is_same<scope::scope_success<void_func_t>, scope::noexcept_::scope_success<void_func_t>>::value));
+    REQUIRE((std::is_same<scope::unique_resource<int, void(*)(int)>, scope::noexcept_::unique_resource<int, void(*)(int)>>::value));
+}
+
+TEST_CASE("without exceptions a copy of the exit function is not guarded")
+{
+    // A copy which is not noexcept selects the noexcept constructor, there
+    // is no handler left to call f().
+    struct copy_may_throw
+    {
+        copy_may_throw() noexcept {}
+        copy_may_throw(const copy_may_throw&) {}
+        void operator()() const noexcept { value_of_func++; }
+    };
+    copy_may_throw f;
+    REQUIRE(std::is_nothrow_constructible<scope::scope_exit<copy_may_throw>, copy_may_throw&>::value);
+    REQUIRE(std::is_nothrow_constructible<scope::scope_fail<copy_may_throw>, copy_may_throw&>::value);
+
+    value_of_func = 0;
+    {
+        scope::scope_exit<copy_may_throw> g{f};
+    }
+    REQUIRE(value_of_func == 1);
+}
+
+TEST_CASE("without exceptions scope stacks and scope_transaction skip the fail actions")
+{
+    std::string out;
+    {
+        scope::scope_success_stack<> success;
+        scope::scope_fail_stack<> fail;
+        success.push([&]{ out += 's'; });
+        fail.push([&]{ out += 'f'; });
+    }
+    REQUIRE(out == "s");
+
+    out.clear();
+    {
+        scope::scope_transaction<> t;
+        t.on_exit([&]{ out += 'e'; });
+        t.on_fail([&]{ out += 'f'; });
+        t.on_success([&]{ out += 's'; });
+    }
+    REQUIRE(out == "se");
+}
+
+#endif // defined(SCOPE_NO_EXCEPTIONS)
@@ -46,11 +46,13 @@ struct Functor
 
 struct TestException : public std::exception {};
 
+#if !defined(SCOPE_NO_EXCEPTIONS)
 struct BadFunctor
 {
     explicit BadFunctor(std::function<void()>) { throw TestException(); }
     void operator()() noexcept {}
 };
+#endif // !defined(SCOPE_NO_EXCEPTIONS)
 
 struct bind_struct
 {
@@ -0,0 +1,44 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_IMPORT_SCOPE_HPP_
+#define NAKATT_IMPORT_SCOPE_HPP_
+
+// Included first (-include) by codegen/module.sh, to run the tests of the
+// exported names through the module scope: the include of scope.hpp which
+// follows is then skipped. The module does not export macros; these hold
+// in C++20. GCC 12 needs the standard headers of the module to be
+// included before it is imported, not after.
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+import scope;
+
+#define NAKATT_SCOPE_HPP_
+#define SCOPE_USE_SUCCESS_FAIL
+#define SCOPE_USE_DEDUCTION_GUIDE
+
+#endif // NAKATT_IMPORT_SCOPE_HPP_
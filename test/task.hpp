@@ -0,0 +1,182 @@
+// MIT License
+// 
+// Copyright (c) 2019 nakat-t <armaiti.wizard@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef NAKATT_TASK_HPP_
+#define NAKATT_TASK_HPP_
+
+#include "scope/async_scope.hpp"
+
+#if defined(SCOPE_USE_COROUTINE)
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <utility>
+
+// A minimal lazy task and a single threaded scheduler, standing in for the
+// task type of a coroutine library in the tests and benchmarks.
+namespace helper {
+
+class scheduler
+{
+public:
+    static scheduler& get()
+    {
+        static scheduler s;
+        return s;
+    }
+
+    void post(std::coroutine_handle<> h) { ready_.push_back(h); }
+
+    void run()
+    {
+        while(!ready_.empty()) {
+            auto h = ready_.front();
+            ready_.pop_front();
+            h.resume();
+        }
+    }
+
+private:
+    std::deque<std::coroutine_handle<>> ready_;
+};
+
+// co_await yield() suspends the coroutine until the scheduler resumes it, as
+// I/O would.
+struct yield
+{
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) const { scheduler::get().post(h); }
+    void await_resume() const noexcept {}
+};
+
+template <typename T>
+class task;
+
+namespace detail {
+
+struct promise_base
+{
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct final_awaiter
+    {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept { return h.promise().continuation; }
+        void await_resume() noexcept {}
+    };
+
+    final_awaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct promise : promise_base
+{
+    std::optional<T> value;
+    task<T> get_return_object() noexcept;
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T result()
+    {
+        if(error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct promise<void> : promise_base
+{
+    task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void result()
+    {
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+} // namespace detail
+
+template <typename T = void>
+class task
+{
+public:
+    using promise_type = detail::promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    explicit task(handle_type h) noexcept : h_(h) {}
+    task(task&& rhs) noexcept : h_(std::exchange(rhs.h_, nullptr)) {}
+    task(const task&) = delete;
+    ~task()
+    {
+        if(h_) {
+            h_.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        h_.promise().continuation = awaiting;
+        return h_;
+    }
+    T await_resume() { return h_.promise().result(); }
+
+    // Runs the task and the scheduler until the task is done.
+    T run()
+    {
+        h_.resume();
+        scheduler::get().run();
+        return h_.promise().result();
+    }
+
+private:
+    handle_type h_;
+};
+
+namespace detail {
+
+template <typename T>
+task<T> promise<T>::get_return_object() noexcept
+{
+    return task<T>{std::coroutine_handle<promise<T>>::from_promise(*this)};
+}
+
+inline task<void> promise<void>::get_return_object() noexcept
+{
+    return task<void>{std::coroutine_handle<promise<void>>::from_promise(*this)};
+}
+
+} // namespace detail
+
+} // namespace helper
+
+#endif // defined(SCOPE_USE_COROUTINE)
+
+#endif // NAKATT_TASK_HPP_